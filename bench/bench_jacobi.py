@@ -0,0 +1,68 @@
+# Copyright (C) 2021 Markus Wallerberger and others
+# SPDX-License-Identifier: MIT
+"""Strong scaling of one-sided Jacobi sweeps with the number of threads.
+
+Times one sweep of `jacobi_sweep` on a random (N + N/4) x N ddouble matrix
+for each number of OpenMP threads, rotating pairs of columns or, if BLOCK is
+given, pairs of column blocks.  Each thread count runs in a subprocess,
+since the OpenMP runtime reads OMP_NUM_THREADS only once.  Reports the time
+per sweep, the speedup over one thread and the parallel efficiency.
+
+Usage: python bench/bench_jacobi.py [SIZE [THREADS,THREADS,... [BLOCK]]]
+"""
+import os
+import subprocess
+import sys
+import time
+
+import numpy as np
+import xprec
+from xprec import _dd_linalg
+
+
+def time_sweep(size, block, repeat=3):
+    # Always time the first sweep, as later ones skip converged pairs
+    rng = np.random.RandomState(4711)
+    A = rng.normal(size=(size + size // 4, size)).astype(xprec.ddouble)
+    offd = np.empty((), xprec.ddouble)
+    times = []
+    for _ in range(repeat):
+        U = np.asfortranarray(A)
+        VT = np.eye(size, dtype=xprec.ddouble)
+        start = time.perf_counter()
+        _dd_linalg.jacobi_sweep(U, VT, block, out=(U, VT, offd))
+        times.append(time.perf_counter() - start)
+    return min(times)
+
+
+def run(size, block, threads):
+    env = dict(os.environ, OMP_NUM_THREADS=str(threads))
+    out = subprocess.run(
+            [sys.executable, __file__, "--sweep", str(size), str(block)],
+            env=env, check=True, capture_output=True, text=True)
+    return float(out.stdout)
+
+
+def main(size=512, threads="1,2,4,8,16,32,64", block=1):
+    size = int(size)
+    block = int(block)
+    threads = [int(t) for t in threads.split(",")]
+    print("kernels: %s, size: %d, block: %d, cpus: %d" % (
+            xprec.dispatch_variant(), size, block, os.cpu_count()))
+    print("%8s %12s %10s %10s" % ("threads", "s/sweep", "speedup",
+                                  "efficiency"))
+    time_1 = None
+    for nthreads in threads:
+        elapsed = run(size, block, nthreads)
+        if time_1 is None:
+            time_1 = elapsed * nthreads
+        speedup = time_1 / elapsed
+        print("%8d %12.4f %10.2f %10.2f" % (
+                nthreads, elapsed, speedup, speedup / nthreads))
+
+
+if __name__ == '__main__':
+    if sys.argv[1:2] == ["--sweep"]:
+        print(time_sweep(int(sys.argv[2]), int(sys.argv[3])))
+    else:
+        main(*sys.argv[1:])
@@ -0,0 +1,52 @@
+# Copyright (C) 2021 Markus Wallerberger and others
+# SPDX-License-Identifier: MIT
+"""Throughput of the ddouble matrix product for square matrices.
+
+Reports GFLOP/s, where multiplying two N x N matrices counts as 2 N**3
+floating-point operations in ddouble (and in double for comparison).  The
+ddouble product is timed for the native kernel and for the Ozaki scheme
+(`xprec.linalg.matmul(..., method="ozaki")`).
+
+Usage: python bench/bench_matmul.py [MAX_SIZE]
+"""
+import sys
+import timeit
+
+import numpy as np
+import xprec
+import xprec.linalg
+
+
+def bench(a, b, method=None, min_time=0.5):
+    number = 1
+    while True:
+        time = timeit.timeit(lambda: xprec.linalg.matmul(a, b, method),
+                             number=number)
+        if time >= min_time or number >= 1000:
+            return time / number
+        number *= 2
+
+
+def main(max_size=4096):
+    rng = np.random.RandomState(4711)
+    print("kernels: %s" % xprec.dispatch_variant())
+    print("%6s %14s %14s %14s" % ("size", "ddouble GF/s", "ozaki GF/s",
+                                  "double GF/s"))
+    size = 16
+    while size <= max_size:
+        a = rng.normal(size=(size, size))
+        b = rng.normal(size=(size, size))
+        flops = 2.0 * size**3
+        a_q = a.astype(xprec.ddouble)
+        b_q = b.astype(xprec.ddouble)
+        time_q = bench(a_q, b_q)
+        time_o = bench(a_q, b_q, "ozaki")
+        time_d = bench(a, b)
+        print("%6d %14.3f %14.3f %14.3f" % (
+                size, 1e-9 * flops / time_q, 1e-9 * flops / time_o,
+                1e-9 * flops / time_d))
+        size *= 2
+
+
+if __name__ == '__main__':
+    main(*map(int, sys.argv[1:]))
@@ -0,0 +1,35 @@
+# Copyright (C) 2021 Markus Wallerberger and others
+# SPDX-License-Identifier: MIT
+"""Per-element latency of elementwise ddouble functions.
+
+Usage: python bench/bench_ufunc.py [SIZE]
+"""
+import sys
+import timeit
+
+import numpy as np
+import xprec
+
+UFUNCS = [np.exp, np.expm1, np.log, np.log2, np.log10, np.log1p, np.sinh,
+          np.cosh, np.tanh, np.sin, np.cos, np.sqrt]
+
+
+def bench(ufunc, x, repeat=5):
+    number = max(1, 100000 // x.size)
+    times = timeit.repeat(lambda: ufunc(x), number=number, repeat=repeat)
+    return min(times) / number / x.size
+
+
+def main(size=100000):
+    rng = np.random.RandomState(4711)
+    x_d = rng.uniform(0.1, 10, size)
+    x_q = x_d.astype(xprec.ddouble)
+    print("kernels: %s, size: %d" % (xprec.dispatch_variant(), size))
+    print("%-8s %12s %12s" % ("ufunc", "ddouble/ns", "double/ns"))
+    for ufunc in UFUNCS:
+        print("%-8s %12.1f %12.1f" % (ufunc.__name__, 1e9 * bench(ufunc, x_q),
+                                      1e9 * bench(ufunc, x_d)))
+
+
+if __name__ == '__main__':
+    main(*map(int, sys.argv[1:]))
@@ -9,6 +9,8 @@
 
 #include "dd_arith.h"
 #include "dd_linalg.h"
+#include "dd_parallel.h"
+#include "dd_simd.h"
 
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include "numpy/ndarraytypes.h"
@@ -22,38 +24,77 @@
 
 /************************ Linear algebra ***************************/
 
-static void u_matmulq(char **args, const npy_intp *dims, const npy_intp* steps,
-                      void *data)
-{
-    // signature (n;i,j),(n;j,k)->(n;i,k)
-    const npy_intp nn = dims[0], ii = dims[1], jj = dims[2], kk = dims[3];
-    const npy_intp _san = steps[0], _sbn = steps[1], _scn = steps[2],
-                   _sai = steps[3], _saj = steps[4], _sbj = steps[5],
-                   _sbk = steps[6], _sci = steps[7], _sck = steps[8];
-    char *_a = args[0], *_b = args[1], *_c = args[2];
+/* Kernels for the instruction set selected at import */
+static const ddkernels *kernels = NULL;
 
-    const npy_intp sai = _sai / sizeof(ddouble), saj = _saj / sizeof(ddouble),
-                   sbj = _sbj / sizeof(ddouble), sbk = _sbk / sizeof(ddouble),
-                   sci = _sci / sizeof(ddouble), sck = _sck / sizeof(ddouble);
+/* Settings for parallel execution, owned by the _dd_ufunc module */
+static const ddparallel *parallel = NULL;
 
-    for (npy_intp n = 0; n != nn; ++n, _a += _san, _b += _sbn, _c += _scn) {
-        const ddouble *a = (const ddouble *)_a, *b = (const ddouble *)_b;
-        ddouble *c = (ddouble *)_c;
-
-        #pragma omp parallel for collapse(2)
-        for (npy_intp i = 0; i < ii; ++i) {
-            for (npy_intp k = 0; k < kk; ++k) {
-                ddouble val = Q_ZERO, tmp;
-                for (npy_intp j = 0; j < jj; ++j) {
-                    tmp = mulqq(a[i * sai + j * saj], b[j * sbj + k * sbk]);
-                    val = addqq(val, tmp);
-                }
-                c[i * sci + k * sck] = val;
-            }
-        }
+/* Matrix products with fewer multiply-adds than this are parallelized
+ * across the stack of matrices rather than within each product.
+ */
+#define MATMUL_BATCH_WORK 262144
+
+/* Defines `func_name`, the matmul loop for `type_a` times `type_b`, which
+ * calls `kernel` of ddkernels for each matrix in the stack.
+ */
+#define ULOOP_MATMUL(func_name, kernel, type_a, type_b)                 \
+    static void func_name(char **args, const npy_intp *dims,            \
+                          const npy_intp* steps, void *data)            \
+    {                                                                   \
+        /* signature (n;i,j),(n;j,k)->(n;i,k) */                        \
+        const npy_intp nn = dims[0], ii = dims[1], jj = dims[2],        \
+                       kk = dims[3];                                    \
+        const npy_intp _san = steps[0], _sbn = steps[1],                \
+                       _scn = steps[2], _sai = steps[3],                \
+                       _saj = steps[4], _sbj = steps[5],                \
+                       _sbk = steps[6], _sci = steps[7],                \
+                       _sck = steps[8];                                 \
+        char *_a = args[0], *_b = args[1], *_c = args[2];               \
+                                                                        \
+        const npy_intp sai = _sai / sizeof(type_a),                     \
+                       saj = _saj / sizeof(type_a),                     \
+                       sbj = _sbj / sizeof(type_b),                     \
+                       sbk = _sbk / sizeof(type_b),                     \
+                       sci = _sci / sizeof(ddouble),                    \
+                       sck = _sck / sizeof(ddouble);                    \
+                                                                        \
+        /* Split the stack across threads if there are enough matrices  \
+         * to keep all threads busy or if the matrices are too small to \
+         * split.  The kernels open parallel regions of their own, so   \
+         * this relies on nested parallelism being disabled (the OpenMP \
+         * default): the products inside the region then run serially   \
+         * rather than oversubscribing the cores.  Empty products have  \
+         * no work to split.                                            \
+         */                                                             \
+        const npy_intp work = ii * jj * kk;                             \
+        const npy_intp nchunks = work == 0 ? 1 : dd_parallel_chunks(    \
+                                        parallel, nn, 2 * work);        \
+        if (nchunks > 1 && (work < MATMUL_BATCH_WORK                    \
+                            || nn >= 4 * nchunks)) {                    \
+            _Pragma("omp parallel for num_threads(nchunks)")            \
+            for (npy_intp n = 0; n < nn; ++n) {                         \
+                kernels->kernel(                                        \
+                        (const type_a *)(_a + n * _san), sai, saj,      \
+                        (const type_b *)(_b + n * _sbn), sbj, sbk,      \
+                        (ddouble *)(_c + n * _scn), sci, sck,           \
+                        ii, jj, kk);                                    \
+            }                                                           \
+            return;                                                     \
+        }                                                               \
+                                                                        \
+        for (npy_intp n = 0; n != nn;                                   \
+                ++n, _a += _san, _b += _sbn, _c += _scn) {              \
+            kernels->kernel((const type_a *)_a, sai, saj,               \
+                            (const type_b *)_b, sbj, sbk,               \
+                            (ddouble *)_c, sci, sck, ii, jj, kk);       \
+        }                                                               \
+        MARK_UNUSED(data);                                              \
     }
-    MARK_UNUSED(data);
-}
+
+ULOOP_MATMUL(u_matmulq, matmul, ddouble, ddouble)
+ULOOP_MATMUL(u_matmuldq, matmuldq, double, ddouble)
+ULOOP_MATMUL(u_matmulqd, matmulqd, ddouble, double)
 
 /****************************** Helper functions *************************/
 
@@ -106,7 +147,8 @@ static void u_normq(
     char *_a = args[0], *_b = args[1];
 
     for (npy_intp n = 0; n != nn; ++n, _a += san, _b += sbn) {
-        *(ddouble *)_b = normq((const ddouble *)_a, ii, _sai / sizeof(ddouble));
+        *(ddouble *)_b = normq((const ddouble *)_a, ii,
+                               _sai / sizeof(ddouble), parallel);
     }
     MARK_UNUSED(data);
 }
@@ -128,6 +170,135 @@ static void u_householderq(
     MARK_UNUSED(data);
 }
 
+static void u_householder_qrq(
+    char **args, const npy_intp *dims, const npy_intp* steps, void *data)
+{
+    // signature (n;i,j)->(n;i,j),(n;j)
+    const npy_intp nn = dims[0], ii = dims[1], jj = dims[2];
+    const npy_intp _san = steps[0], _sbn = steps[1], _scn = steps[2],
+                   _sai = steps[3], _saj = steps[4], _sbi = steps[5],
+                   _sbj = steps[6], _scj = steps[7];
+    char *_a = args[0], *_b = args[1], *_c = args[2];
+
+    for (npy_intp n = 0; n != nn; ++n, _a += _san, _b += _sbn, _c += _scn) {
+        ensure_inplace_2(_a, _b, ii, _sai, _sbi, jj, _saj, _sbj);
+        householder_qrq((ddouble *)_b, _sbi / sizeof(ddouble),
+                        _sbj / sizeof(ddouble), (ddouble *)_c,
+                        _scj / sizeof(ddouble), ii, jj, kernels);
+    }
+    MARK_UNUSED(data);
+}
+
+static void u_householder_rrqrq(
+    char **args, const npy_intp *dims, const npy_intp* steps, void *data)
+{
+    // signature (n;i,j),(n;)->(n;i,j),(n;j),(n;j),(n;)
+    const npy_intp nn = dims[0], ii = dims[1], jj = dims[2];
+    const npy_intp _san = steps[0], _sbn = steps[1], _scn = steps[2],
+                   _sdn = steps[3], _sen = steps[4], _sfn = steps[5],
+                   _sai = steps[6], _saj = steps[7], _sci = steps[8],
+                   _scj = steps[9], _sdj = steps[10], _sej = steps[11];
+    char *_a = args[0], *_b = args[1], *_c = args[2], *_d = args[3],
+         *_e = args[4], *_f = args[5];
+
+    long *jpvt = malloc(jj * sizeof(long));
+    for (npy_intp n = 0; n != nn; ++n, _a += _san, _b += _sbn, _c += _scn,
+                                       _d += _sdn, _e += _sen, _f += _sfn) {
+        long rank = -1;
+        if (jpvt != NULL) {
+            ensure_inplace_2(_a, _c, ii, _sai, _sci, jj, _saj, _scj);
+            rank = householder_rrqrq(
+                        (ddouble *)_c, _sci / sizeof(ddouble),
+                        _scj / sizeof(ddouble), (ddouble *)_d,
+                        _sdj / sizeof(ddouble), jpvt, ii, jj,
+                        *(const ddouble *)_b, kernels);
+        }
+        for (npy_intp j = 0; j != jj; ++j)
+            *(npy_intp *)(_e + j * _sej) = rank >= 0 ? jpvt[j] : j;
+        *(npy_intp *)_f = rank;
+    }
+    free(jpvt);
+    MARK_UNUSED(data);
+}
+
+static void u_lu_solveq(
+    char **args, const npy_intp *dims, const npy_intp* steps, void *data)
+{
+    // signature (n;i,i),(n;i,j)->(n;i,j),(n;)
+    const npy_intp nn = dims[0], ii = dims[1], jj = dims[2];
+    const npy_intp _san = steps[0], _sbn = steps[1], _scn = steps[2],
+                   _sdn = steps[3], _sai = steps[4], _saj = steps[5],
+                   _sbi = steps[6], _sbj = steps[7], _sci = steps[8],
+                   _scj = steps[9];
+    char *_a = args[0], *_b = args[1], *_c = args[2], *_d = args[3];
+
+    ddouble *lu = malloc(ii * ii * sizeof(ddouble));
+    long *piv = malloc(ii * sizeof(long));
+    for (npy_intp n = 0; n != nn; ++n, _a += _san, _b += _sbn, _c += _scn,
+                                       _d += _sdn) {
+        long info = -1;
+        if (lu != NULL && piv != NULL) {
+            for (npy_intp i = 0; i != ii; ++i) {
+                for (npy_intp k = 0; k != ii; ++k)
+                    lu[i * ii + k] = *(ddouble *)(_a + i * _sai + k * _saj);
+            }
+            info = lu_factorq(lu, ii, 1, piv, ii, kernels);
+        }
+        ensure_inplace_2(_b, _c, ii, _sbi, _sci, jj, _sbj, _scj);
+        if (info == 0) {
+            lu_solveq(lu, ii, 1, piv, ii, (ddouble *)_c,
+                      _sci / sizeof(ddouble), _scj / sizeof(ddouble), jj,
+                      kernels);
+        }
+        *(npy_intp *)_d = info;
+    }
+    free(lu);
+    free(piv);
+    MARK_UNUSED(data);
+}
+
+static void householder_apply_loop(
+    char **args, const npy_intp *dims, const npy_intp* steps, bool trans,
+    bool unit)
+{
+    // signature (n;i,k),(n;i,j)->(n;i,j)
+    const npy_intp nn = dims[0], ii = dims[1], kk = dims[2], jj = dims[3];
+    const npy_intp _san = steps[0], _sbn = steps[1], _scn = steps[2],
+                   _sai = steps[3], _sak = steps[4], _sbi = steps[5],
+                   _sbj = steps[6], _sci = steps[7], _scj = steps[8];
+    char *_a = args[0], *_b = args[1], *_c = args[2];
+
+    for (npy_intp n = 0; n != nn; ++n, _a += _san, _b += _sbn, _c += _scn) {
+        if (!unit)
+            ensure_inplace_2(_b, _c, ii, _sbi, _sci, jj, _sbj, _scj);
+        householder_applyq((const ddouble *)_a, _sai / sizeof(ddouble),
+                           _sak / sizeof(ddouble), ii, kk, (ddouble *)_c,
+                           _sci / sizeof(ddouble), _scj / sizeof(ddouble),
+                           jj, trans, unit, kernels);
+    }
+}
+
+static void u_householder_applyq(
+    char **args, const npy_intp *dims, const npy_intp* steps, void *data)
+{
+    householder_apply_loop(args, dims, steps, false, false);
+    MARK_UNUSED(data);
+}
+
+static void u_householder_apply_tq(
+    char **args, const npy_intp *dims, const npy_intp* steps, void *data)
+{
+    householder_apply_loop(args, dims, steps, true, false);
+    MARK_UNUSED(data);
+}
+
+static void u_householder_qq(
+    char **args, const npy_intp *dims, const npy_intp* steps, void *data)
+{
+    householder_apply_loop(args, dims, steps, false, true);
+    MARK_UNUSED(data);
+}
+
 static void u_rank1updateq(
     char **args, const npy_intp *dims, const npy_intp* steps, void *data)
 {
@@ -141,7 +312,7 @@ static void u_rank1updateq(
 
     ensure_inplace_3(_a, _d, nn, _san, _sdn, ii, _sai, _sdi, jj, _saj, _sdj);
     for (npy_intp n = 0; n != nn; ++n, _a += _san, _b += _sbn, _c += _scn) {
-        rank1updateq(
+        kernels->rank1update(
             (ddouble *)_d, _sai / sizeof(ddouble), _saj / sizeof(ddouble),
             (const ddouble *)_b, _sbi / sizeof(ddouble),
             (const ddouble *)_c, _scj / sizeof(ddouble), ii, jj);
@@ -152,25 +323,27 @@ static void u_rank1updateq(
 static void u_jacobisweepq(
     char **args, const npy_intp *dims, const npy_intp* steps, void *data)
 {
-    // signature (n;i,j),(n;i=j,j)->(n;i,j),(n;i=j,j);(n,)
+    // signature (n;i,j),(n;i=j,j),(n;)->(n;i,j),(n;i=j,j);(n,)
     const npy_intp nn = dims[0], ii = dims[1], jj = dims[2];
-    const npy_intp _san = steps[0], _sbn = steps[1],  _scn = steps[2],
-                   _sdn = steps[3], _sen = steps[4],  _sai = steps[5],
-                   _saj = steps[6], _sbi = steps[7],  _sbj = steps[8],
-                   _sci = steps[9], _scj = steps[10], _sdi = steps[11],
-                   _sdj = steps[12];
+    const npy_intp _san = steps[0], _sbn = steps[1], _scn = steps[2],
+                   _sdn = steps[3], _sen = steps[4], _sfn = steps[5],
+                   _sai = steps[6], _saj = steps[7], _sbi = steps[8],
+                   _sbj = steps[9], _sdi = steps[10], _sdj = steps[11],
+                   _sei = steps[12], _sej = steps[13];
     char *_a = args[0], *_b = args[1], *_c = args[2], *_d = args[3],
-         *_e = args[4];
+         *_e = args[4], *_f = args[5];
 
-    ensure_inplace_3(_a, _c, nn, _san, _scn, ii, _sai, _sci, jj, _saj, _scj);
-    ensure_inplace_3(_b, _d, nn, _sbn, _sdn, jj, _sbi, _sdi, jj, _sbj, _sdj);
-    for (npy_intp n = 0; n != nn; ++n, _c += _scn, _d += _sdn, _e += _sen) {
-        ddouble *c = (ddouble *)_c, *d = (ddouble *)_d, *e = (ddouble *)_e;
+    ensure_inplace_3(_a, _d, nn, _san, _sdn, ii, _sai, _sdi, jj, _saj, _sdj);
+    ensure_inplace_3(_b, _e, nn, _sbn, _sen, jj, _sbi, _sei, jj, _sbj, _sej);
+    for (npy_intp n = 0; n != nn; ++n, _c += _scn, _d += _sdn, _e += _sen,
+                                       _f += _sfn) {
+        ddouble *d = (ddouble *)_d, *e = (ddouble *)_e, *f = (ddouble *)_f;
         const npy_intp
-                sci = _sci / sizeof(ddouble), scj = _scj / sizeof(ddouble),
-                sdi = _sdi / sizeof(ddouble), sdj = _sdj / sizeof(ddouble);
+                sdi = _sdi / sizeof(ddouble), sdj = _sdj / sizeof(ddouble),
+                sei = _sei / sizeof(ddouble), sej = _sej / sizeof(ddouble);
 
-        *e = jacobi_sweep(c, sci, scj, d, sdi, sdj, ii, jj);
+        *f = jacobi_sweep(d, sdi, sdj, e, sei, sej, ii, jj,
+                          *(const npy_intp *)_c, kernels);
     }
     MARK_UNUSED(data);
 }
@@ -258,6 +431,84 @@ static void u_golub_kahan_chaseq(
     MARK_UNUSED(data);
 }
 
+static void u_svd_bidiagq(
+    char **args, const npy_intp *dims, const npy_intp* steps, void *data)
+{
+    // signature (n;k),(n;k),(n;i,k),(n;k,j)->(n;k),(n;i,k),(n;k,j),(n;)
+    const npy_intp nn = dims[0], kk = dims[1], ii = dims[2], jj = dims[3];
+    const npy_intp _san = steps[0], _sbn = steps[1], _scn = steps[2],
+                   _sdn = steps[3], _sen = steps[4], _sfn = steps[5],
+                   _sgn = steps[6], _shn = steps[7], _sak = steps[8],
+                   _sbk = steps[9], _sci = steps[10], _sck = steps[11],
+                   _sdk = steps[12], _sdj = steps[13], _sek = steps[14],
+                   _sfi = steps[15], _sfk = steps[16], _sgk = steps[17],
+                   _sgj = steps[18];
+    char *_a = args[0], *_b = args[1], *_c = args[2], *_d = args[3],
+         *_e = args[4], *_f = args[5], *_g = args[6], *_h = args[7];
+
+    /* Off-diagonal elements are kept contiguous, followed by rotations */
+    ddouble *work = malloc(5 * kk * sizeof(ddouble));
+    for (npy_intp n = 0; n != nn; ++n, _a += _san, _b += _sbn, _c += _scn,
+                _d += _sdn, _e += _sen, _f += _sfn, _g += _sgn, _h += _shn) {
+        if (work == NULL) {
+            *(npy_intp *)_h = -1;
+            continue;
+        }
+        ensure_inplace_2(_a, _e, 1, 0, 0, kk, _sak, _sek);
+        ensure_inplace_2(_c, _f, ii, _sci, _sfi, kk, _sck, _sfk);
+        ensure_inplace_2(_d, _g, kk, _sdk, _sgk, jj, _sdj, _sgj);
+        for (npy_intp k = 0; k < kk - 1; ++k)
+            work[k] = *(ddouble *)(_b + k * _sbk);
+
+        *(npy_intp *)_h = svd_bidiagq(
+                    (ddouble *)_e, _sek / sizeof(ddouble), work, 1, kk,
+                    (ddouble *)_f, _sfi / sizeof(ddouble),
+                    _sfk / sizeof(ddouble), ii,
+                    (ddouble *)_g, _sgk / sizeof(ddouble),
+                    _sgj / sizeof(ddouble), jj, 20 * kk, work + kk, kernels);
+    }
+    free(work);
+    MARK_UNUSED(data);
+}
+
+static void u_svd_bidiag_dcq(
+    char **args, const npy_intp *dims, const npy_intp* steps, void *data)
+{
+    // signature (n;k),(n;k)->(n;k),(n;k,k),(n;k,k),(n;)
+    const npy_intp nn = dims[0], kk = dims[1];
+    const npy_intp _san = steps[0], _sbn = steps[1], _scn = steps[2],
+                   _sdn = steps[3], _sen = steps[4], _sfn = steps[5],
+                   _sak = steps[6], _sbk = steps[7], _sck = steps[8],
+                   _sdi = steps[9], _sdk = steps[10], _sei = steps[11],
+                   _sek = steps[12];
+    char *_a = args[0], *_b = args[1], *_c = args[2], *_d = args[3],
+         *_e = args[4], *_f = args[5];
+
+    /* Contiguous copies of the diagonals */
+    ddouble *work = malloc(2 * kk * sizeof(ddouble));
+    for (npy_intp n = 0; n != nn; ++n, _a += _san, _b += _sbn, _c += _scn,
+                _d += _sdn, _e += _sen, _f += _sfn) {
+        if (work == NULL) {
+            *(npy_intp *)_f = -1;
+            continue;
+        }
+        for (npy_intp k = 0; k < kk; ++k) {
+            work[k] = *(ddouble *)(_a + k * _sak);
+            work[kk + k] = *(ddouble *)(_b + k * _sbk);
+        }
+        *(npy_intp *)_f = svd_bidiag_dcq(
+                    work, work + kk, kk,
+                    (ddouble *)_d, _sdi / sizeof(ddouble),
+                    _sdk / sizeof(ddouble),
+                    (ddouble *)_e, _sei / sizeof(ddouble),
+                    _sek / sizeof(ddouble), kernels);
+        for (npy_intp k = 0; k < kk; ++k)
+            *(ddouble *)(_c + k * _sck) = work[k];
+    }
+    free(work);
+    MARK_UNUSED(data);
+}
+
 static void u_svd_2x2(
     char **args, const npy_intp *dims, const npy_intp* steps, void *data)
 {
@@ -356,16 +607,23 @@ static int import_ddouble_dtype()
     if (type_num == NPY_NOTYPE)
         return -1;
 
+    parallel = PyCapsule_Import("xprec._dd_ufunc._parallel", 0);
+    if (parallel == NULL)
+        return -1;
+
     return 0;
 }
 
-static int gufunc(
+/* Register gufunc loop with argument types `arg_types`, where NULL means
+ * that all arguments are ddouble.
+ */
+static int gufunc_typed(
         PyUFuncGenericFunction uloop, int nin, int nout,
         const char *signature, const char *name, const char *docstring,
-        bool in_numpy)
+        bool in_numpy, int *arg_types)
 {
     PyUFuncObject *ufunc = NULL;
-    int *arg_types = NULL, retcode = 0;
+    int retcode = 0;
 
     if (in_numpy) {
         ufunc = (PyUFuncObject *)PyObject_GetAttrString(numpy_module, name);
@@ -376,12 +634,6 @@ static int gufunc(
     }
     if (ufunc == NULL) goto error;
 
-    int *dtypes = PyMem_New(int, nin + nout);
-    if (dtypes == NULL) goto error;
-
-    for (int i = 0; i != nin + nout; ++i)
-        dtypes[i] = type_num;
-
     retcode = PyUFunc_RegisterLoopForType(ufunc, type_num,
                                           uloop, arg_types, NULL);
     if (retcode < 0) goto error;
@@ -391,10 +643,31 @@ static int gufunc(
 error:
     if (!in_numpy)
         Py_XDECREF(ufunc);
-    PyMem_Free(arg_types);
     return -1;
 }
 
+static int gufunc(
+        PyUFuncGenericFunction uloop, int nin, int nout,
+        const char *signature, const char *name, const char *docstring,
+        bool in_numpy)
+{
+    return gufunc_typed(uloop, nin, nout, signature, name, docstring,
+                        in_numpy, NULL);
+}
+
+static int register_loop(PyUFuncGenericFunction uloop, int *arg_types,
+                         const char *name)
+{
+    PyObject *ufunc = PyObject_GetAttrString(numpy_module, name);
+    if (ufunc == NULL)
+        return -1;
+
+    int retcode = PyUFunc_RegisterLoopForType(
+                    (PyUFuncObject *)ufunc, type_num, uloop, arg_types, NULL);
+    Py_DECREF(ufunc);
+    return retcode;
+}
+
 PyMODINIT_FUNC PyInit__dd_linalg(void)
 {
     if (!make_module())
@@ -411,26 +684,68 @@ PyMODINIT_FUNC PyInit__dd_linalg(void)
     if (import_ddouble_dtype() < 0)
         return NULL;
 
+    kernels = dd_select_kernels();
+
     gufunc(u_normq, 1, 1, "(i)->()",
            "norm", "Vector 2-norm", false);
     gufunc(u_matmulq, 2, 1, "(i?,j),(j,k?)->(i?,k?)",
            "matmul", "Matrix multiplication", true);
+
+    // Mixed products avoid casting the double operand to ddouble
+    int matmuldq_types[] = {NPY_DOUBLE, type_num, type_num};
+    int matmulqd_types[] = {type_num, NPY_DOUBLE, type_num};
+    register_loop(u_matmuldq, matmuldq_types, "matmul");
+    register_loop(u_matmulqd, matmulqd_types, "matmul");
     gufunc(u_givensq, 1, 2, "(2)->(2),(2,2)",
            "givens", "Generate Givens rotation", false);
     gufunc(u_givens_seqq, 2, 1, "(i,2),(i,j?)->(i,j?)",
            "givens_seq", "apply sequence of givens rotation to matrix", false);
     gufunc(u_householderq, 1, 2, "(i)->(),(i)",
            "householder", "Generate Householder reflectors", false);
+    gufunc(u_householder_qrq, 1, 2, "(i,j)->(i,j),(j)",
+           "householder_qr", "Blocked Householder QR in compact form", false);
+    int rrqr_types[] = {type_num, type_num, type_num, type_num, NPY_INTP,
+                        NPY_INTP};
+    gufunc_typed(u_householder_rrqrq, 2, 4, "(i,j),()->(i,j),(j),(j),()",
+                 "householder_rrqr", "Householder QR with column pivoting",
+                 false, rrqr_types);
+    int lu_solve_types[] = {type_num, type_num, type_num, NPY_INTP};
+    gufunc_typed(u_lu_solveq, 2, 2, "(i,i),(i,j)->(i,j),()",
+                 "lu_solve", "Solve linear system by LU with partial pivoting",
+                 false, lu_solve_types);
+    gufunc(u_householder_applyq, 2, 1, "(i,k),(i,j)->(i,j)",
+           "householder_apply", "Apply product of Householder reflectors",
+           false);
+    gufunc(u_householder_apply_tq, 2, 1, "(i,k),(i,j)->(i,j)",
+           "householder_apply_t",
+           "Apply transpose of product of Householder reflectors", false);
+    gufunc(u_householder_qq, 2, 1, "(i,k),(i,j)->(i,j)",
+           "householder_q", "Form product of Householder reflectors "
+           "(second argument only gives the shape)", false);
     gufunc(u_rank1updateq, 3, 1, "(i,j),(i),(j)->(i,j)",
            "rank1update", "Perform rank-1 update of matrix", false);
     gufunc(u_svd_2x2, 1, 3, "(2,2)->(2,2),(2),(2,2)",
            "svd2x2", "SVD of upper triangular 2x2 problem", false);
     gufunc(u_svvals_2x2, 1, 1, "(2,2)->(2)",
            "svvals2x2", "singular values of upper triangular 2x2 problem", false);
-    gufunc(u_jacobisweepq, 2, 3, "(i,j),(j,j)->(i,j),(j,j),()",
-           "jacobi_sweep", "Perform sweep of one-sided Jacobi rotations", false);
+    int jacobi_sweep_types[] = {type_num, type_num, NPY_INTP, type_num,
+                                type_num, type_num};
+    gufunc_typed(u_jacobisweepq, 3, 3, "(i,j),(j,j),()->(i,j),(j,j),()",
+                 "jacobi_sweep", "Perform sweep of one-sided Jacobi rotations "
+                 "on blocks of columns", false, jacobi_sweep_types);
     gufunc(u_golub_kahan_chaseq, 2, 3, "(i),(i)->(i),(i),(i,4)",
            "golub_kahan_chase", "bidiagonal chase procedure", false);
+    int svd_bidiag_types[] = {type_num, type_num, type_num, type_num,
+                              type_num, type_num, type_num, NPY_INTP};
+    gufunc_typed(u_svd_bidiagq, 4, 4,
+                 "(k),(k),(i,k),(k,j)->(k),(i,k),(k,j),()", "svd_bidiag",
+                 "SVD of bidiagonal matrix by implicit QR", false,
+                 svd_bidiag_types);
+    int svd_bidiag_dc_types[] = {type_num, type_num, type_num, type_num,
+                                 type_num, NPY_INTP};
+    gufunc_typed(u_svd_bidiag_dcq, 2, 4, "(k),(k)->(k),(k,k),(k,k),()",
+                 "svd_bidiag_dc", "SVD of bidiagonal matrix by divide and "
+                 "conquer", false, svd_bidiag_dc_types);
 
     /* Make dtype */
     PyArray_Descr *dtype = PyArray_DescrFromType(NPY_CDOUBLE);
@@ -14,6 +14,8 @@
 #include <stdalign.h>
 
 #include "dd_arith.h"
+#include "dd_parallel.h"
+#include "dd_simd.h"
 
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include "numpy/ndarraytypes.h"
@@ -38,6 +40,12 @@ static int type_num = -1;  //FIXME
 static PyTypeObject *pyddouble_type = NULL;
 static PyObject *pyddouble_finfo = NULL;
 
+/* Kernels for the instruction set selected at import */
+static const ddkernels *kernels = NULL;
+
+/* Settings for parallel execution, shared with the other modules */
+static ddparallel parallel = { 32768, false };
+
 typedef struct {
     PyObject_HEAD
     ddouble x;
@@ -473,16 +481,25 @@ static int NPyDDouble_FillWithScalar(void *_buffer, npy_intp ii, void *_value,
     MARK_UNUSED(arr);
 }
 
+typedef struct {
+    const ddouble *a, *b;
+    npy_intp sa, sb;
+} dot_args;
+
+static ddouble dot_block(const void *_args, long start, long size)
+{
+    const dot_args *args = (const dot_args *)_args;
+    return kernels->dot(args->a + start * args->sa, args->sa,
+                        args->b + start * args->sb, args->sb, size);
+}
+
 static void NPyDDouble_DotFunc(void *_in1, npy_intp is1, void *_in2,
                                npy_intp is2, void *_out, npy_intp ii, void *arr)
 {
-    ddouble out = Q_ZERO;
-    char *_cin1 = (char *)_in1, *_cin2 = (char *)_in2;
-    for (npy_intp i = 0; i < ii; ++i, _cin1 += is1, _cin2 += is2) {
-        ddouble in1 = *(ddouble *)_cin1, in2 = *(ddouble *)_cin2;
-        out = addqq(out, mulqq(in1, in2));
-    }
-    *(ddouble *)_out = out;
+    dot_args args = {(const ddouble *)_in1, (const ddouble *)_in2,
+                     is1 / sizeof(ddouble), is2 / sizeof(ddouble)};
+    *(ddouble *)_out = dd_parallel_reduce(&parallel, dot_block, addqq, &args,
+                                          ii, 2);
     MARK_UNUSED(arr);
 }
 
@@ -700,6 +717,154 @@ static int register_casts()
 
 /* ------------------------------- Ufuncs ----------------------------- */
 
+static bool extents_overlap(const char *a, npy_intp sa, const char *b,
+                            npy_intp sb, npy_intp n)
+{
+    /* Conservatively assume elements of 16 bytes */
+    const char *a_lo = sa < 0 ? a + (n - 1) * sa : a;
+    const char *a_hi = (sa < 0 ? a : a + (n - 1) * sa) + 16;
+    const char *b_lo = sb < 0 ? b + (n - 1) * sb : b;
+    const char *b_hi = (sb < 0 ? b : b + (n - 1) * sb) + 16;
+    return a_lo < b_hi && b_lo < a_hi;
+}
+
+/**
+ * Return true if the iterations of an inner loop with `nin` inputs and
+ * `nout` outputs are independent, i.e., if no iteration reads or writes an
+ * output element written by another iteration.
+ *
+ * This is not the case for `ufunc.reduce` and `ufunc.accumulate`, where the
+ * output overlaps with the first input.  Such loops must be run in order
+ * and cannot use the vectorized or parallel code paths.
+ */
+static bool independent_elements(char **args, const npy_intp *dimensions,
+                                 const npy_intp *steps, int nin, int nout)
+{
+    const npy_intp n = dimensions[0];
+    if (n < 2)
+        return true;
+
+    for (int o = nin; o < nin + nout; ++o) {
+        if (steps[o] == 0)
+            return false;
+        for (int i = 0; i < nin + nout; ++i) {
+            if (i == o || (args[i] == args[o] && steps[i] == steps[o]))
+                continue;
+            if (extents_overlap(args[i], steps[i], args[o], steps[o], n))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Run the inner loop `chunk` of a ufunc with `nin` inputs and `nout`
+ * outputs, splitting it across threads if the work, `cost` per element, is
+ * large enough and the iterations are independent.
+ *
+ * Elements are assigned to threads in contiguous blocks, so the result does
+ * not depend on the number of threads.
+ */
+static void parallel_loop(PyUFuncGenericFunction chunk, int nin, int nout,
+                          npy_intp cost, char **args,
+                          const npy_intp *dimensions, const npy_intp *steps,
+                          void *data)
+{
+    const npy_intp n = dimensions[0];
+    npy_intp nchunks = dd_parallel_chunks(&parallel, n, cost);
+    if (nchunks < 2
+            || !independent_elements(args, dimensions, steps, nin, nout)) {
+        chunk(args, dimensions, steps, data);
+        return;
+    }
+
+    #pragma omp parallel for
+    for (npy_intp c = 0; c < nchunks; ++c) {
+        npy_intp start = c * n / nchunks;
+        npy_intp size = (c + 1) * n / nchunks - start;
+        char *chunk_args[NPY_MAXARGS];
+        for (int i = 0; i < nin + nout; ++i)
+            chunk_args[i] = args[i] + start * steps[i];
+        chunk(chunk_args, &size, steps, data);
+    }
+}
+
+typedef struct {
+    ddkernel_reduce kernel;
+    const ddouble *a;
+    npy_intp sa;
+} reduce_args;
+
+static ddouble reduce_block(const void *_args, long start, long size)
+{
+    const reduce_args *args = (const reduce_args *)_args;
+    return args->kernel(args->a + start * args->sa, args->sa, size);
+}
+
+typedef struct {
+    const double *a, *b;
+    npy_intp sa, sb;
+} dot2_args;
+
+static ddouble dot2_block(const void *_args, long start, long size)
+{
+    const dot2_args *args = (const dot2_args *)_args;
+    if (args->b == NULL)
+        return kernels->sum2(args->a + start * args->sa, args->sa, size);
+    return kernels->dot2(args->a + start * args->sa, args->sa,
+                         args->b + start * args->sb, args->sb, size);
+}
+
+static void u_dot2(char **args, const npy_intp *dims, const npy_intp *steps,
+                   void *data)
+{
+    // signature (n;i),(n;i)->(n;2)
+    const npy_intp nn = dims[0], ii = dims[1];
+    const npy_intp san = steps[0], sbn = steps[1], scn = steps[2],
+                   sai = steps[3], sbi = steps[4], sc2 = steps[5];
+    char *_a = args[0], *_b = args[1], *_c = args[2];
+
+    for (npy_intp n = 0; n != nn; ++n, _a += san, _b += sbn, _c += scn) {
+        dot2_args dot = {(const double *)_a, (const double *)_b,
+                         sai / sizeof(double), sbi / sizeof(double)};
+        ddouble res = dd_parallel_reduce(&parallel, dot2_block, addqq, &dot,
+                                         ii, 1);
+        *(double *)_c = res.hi;
+        *(double *)(_c + sc2) = res.lo;
+    }
+    MARK_UNUSED(data);
+}
+
+static void u_sum2(char **args, const npy_intp *dims, const npy_intp *steps,
+                   void *data)
+{
+    // signature (n;i)->(n;2)
+    const npy_intp nn = dims[0], ii = dims[1];
+    const npy_intp san = steps[0], scn = steps[1], sai = steps[2],
+                   sc2 = steps[3];
+    char *_a = args[0], *_c = args[1];
+
+    for (npy_intp n = 0; n != nn; ++n, _a += san, _c += scn) {
+        dot2_args sum = {(const double *)_a, NULL, sai / sizeof(double), 0};
+        ddouble res = dd_parallel_reduce(&parallel, dot2_block, addqq, &sum,
+                                         ii, 1);
+        *(double *)_c = res.hi;
+        *(double *)(_c + sc2) = res.lo;
+    }
+    MARK_UNUSED(data);
+}
+
+/* Defines `func_name`, which splits the inner loop `chunk` with `nin`
+ * inputs, `nout` outputs and cost `cost` per element across threads.
+ */
+#define ULOOP_PARALLEL(func_name, chunk, nin, nout, cost)               \
+    static void func_name(char **args, const npy_intp *dimensions,      \
+                          const npy_intp *steps, void *data)            \
+    {                                                                   \
+        parallel_loop(chunk, nin, nout, cost, args, dimensions, steps,  \
+                      data);                                            \
+    }
+
 #define ULOOP_UNARY(func_name, inner_func, type_out, type_in)           \
     static void func_name(char **args, const npy_intp *dimensions,      \
                           const npy_intp *steps, void *data)            \
@@ -733,18 +898,124 @@ static int register_casts()
         MARK_UNUSED(data);                                              \
     }
 
-ULOOP_BINARY(u_addqd, addqd, ddouble, ddouble, double)
-ULOOP_BINARY(u_subqd, subqd, ddouble, ddouble, double)
-ULOOP_BINARY(u_mulqd, mulqd, ddouble, ddouble, double)
-ULOOP_BINARY(u_divqd, divqd, ddouble, ddouble, double)
-ULOOP_BINARY(u_adddq, adddq, ddouble, double, ddouble)
-ULOOP_BINARY(u_subdq, subdq, ddouble, double, ddouble)
-ULOOP_BINARY(u_muldq, muldq, ddouble, double, ddouble)
-ULOOP_BINARY(u_divdq, divdq, ddouble, double, ddouble)
-ULOOP_BINARY(u_addqq, addqq, ddouble, ddouble, ddouble)
-ULOOP_BINARY(u_subqq, subqq, ddouble, ddouble, ddouble)
-ULOOP_BINARY(u_mulqq, mulqq, ddouble, ddouble, ddouble)
-ULOOP_BINARY(u_divqq, divqq, ddouble, ddouble, ddouble)
+/* Same as ULOOP_BINARY, but dispatches to a vectorized kernel if all
+ * operands are contiguous and the iterations are independent, and runs
+ * in parallel for large arrays.  `kernel` names a member of ddkernels.
+ */
+#define ULOOP_BINARY_VEC(func_name, inner_func, kernel, cost, type_out,   \
+                         type_a, type_b)                                \
+    static void func_name##_chunk(char **args,                          \
+                                  const npy_intp *dimensions,           \
+                          const npy_intp* steps, void *data)            \
+    {                                                                   \
+        const npy_intp n = dimensions[0];                               \
+        const npy_intp as = steps[0] / sizeof(type_a),                  \
+                       bs = steps[1] / sizeof(type_b),                  \
+                       os = steps[2] / sizeof(type_out);                \
+        const type_a *a = (const type_a *)args[0];                      \
+        const type_b *b = (const type_b *)args[1];                      \
+        type_out *out = (type_out *)args[2];                            \
+                                                                        \
+        bool contiguous = steps[0] == sizeof(type_a)                    \
+                && steps[1] == sizeof(type_b)                           \
+                && steps[2] == sizeof(type_out);                        \
+        if (contiguous && independent_elements(args, dimensions, steps, \
+                                               2, 1)) {                 \
+            kernels->kernel(a, b, out, n);                              \
+            return;                                                     \
+        }                                                               \
+        for (npy_intp i = 0; i < n; ++i) {                              \
+            out[i * os] = inner_func(a[i * as], b[i * bs]);             \
+        }                                                               \
+        MARK_UNUSED(data);                                              \
+    }                                                                   \
+    ULOOP_PARALLEL(func_name, func_name##_chunk, 2, 1, cost)
+
+/* Defines `func_name`, which uses the reduction `kernel` of ddkernels if
+ * called by `ufunc.reduce` along a one-dimensional slice, i.e., if the first
+ * operand and the output are the same scalar, and calls the loop
+ * `elementwise` otherwise.
+ */
+#define ULOOP_REDUCE(func_name, elementwise, kernel, combine, cost)     \
+    static void func_name(char **args, const npy_intp *dimensions,      \
+                          const npy_intp* steps, void *data)            \
+    {                                                                   \
+        if (args[0] != args[2] || steps[0] != 0 || steps[2] != 0) {     \
+            elementwise(args, dimensions, steps, data);                 \
+            return;                                                     \
+        }                                                               \
+        ddouble *out = (ddouble *)args[2];                              \
+        reduce_args red_args = {kernels->kernel,                        \
+                                (const ddouble *)args[1],               \
+                                steps[1] / sizeof(ddouble)};            \
+        ddouble red = dd_parallel_reduce(&parallel, reduce_block,       \
+                                         combine, &red_args,            \
+                                         dimensions[0], cost);          \
+        *out = combine(*out, red);                                      \
+    }
+
+/* Unary ddouble function for which ddkernels has a member `kernel`, run in
+ * parallel for large arrays.
+ */
+#define ULOOP_UNARY_KERNEL(func_name, kernel, cost)                     \
+    static void func_name##_chunk(char **args,                          \
+                                  const npy_intp *dimensions,           \
+                                  const npy_intp *steps, void *data)    \
+    {                                                                   \
+        kernels->kernel((const ddouble *)args[0],                       \
+                        steps[0] / sizeof(ddouble),                     \
+                        (ddouble *)args[1],                             \
+                        steps[1] / sizeof(ddouble), dimensions[0]);     \
+        MARK_UNUSED(data);                                              \
+    }                                                                   \
+    ULOOP_PARALLEL(func_name, func_name##_chunk, 1, 1, cost)
+
+ULOOP_BINARY_VEC(u_addqd_elementwise, addqd, addqd, 1, ddouble, ddouble,
+                 double)
+ULOOP_BINARY_VEC(u_subqd, subqd, subqd, 1, ddouble, ddouble, double)
+ULOOP_BINARY_VEC(u_mulqd, mulqd, mulqd, 1, ddouble, ddouble, double)
+ULOOP_BINARY_VEC(u_divqd, divqd, divqd, 2, ddouble, ddouble, double)
+ULOOP_BINARY_VEC(u_adddq, adddq, adddq, 1, ddouble, double, ddouble)
+ULOOP_BINARY_VEC(u_subdq, subdq, subdq, 1, ddouble, double, ddouble)
+ULOOP_BINARY_VEC(u_muldq, muldq, muldq, 1, ddouble, double, ddouble)
+ULOOP_BINARY_VEC(u_divdq, divdq, divdq, 2, ddouble, double, ddouble)
+ULOOP_BINARY_VEC(u_addqq_elementwise, addqq, addqq, 1, ddouble, ddouble,
+                 ddouble)
+ULOOP_BINARY_VEC(u_subqq, subqq, subqq, 1, ddouble, ddouble, ddouble)
+ULOOP_BINARY_VEC(u_mulqq_elementwise, mulqq, mulqq, 1, ddouble, ddouble,
+                 ddouble)
+ULOOP_REDUCE(u_addqq, u_addqq_elementwise, sum, addqq, 1)
+ULOOP_REDUCE(u_mulqq, u_mulqq_elementwise, prod, mulqq, 1)
+
+typedef struct {
+    const double *a;
+    npy_intp sa;
+} sumd_args;
+
+static ddouble sumd_block(const void *_args, long start, long size)
+{
+    const sumd_args *args = (const sumd_args *)_args;
+    return kernels->sumd(args->a + start * args->sa, args->sa, size);
+}
+
+/* Adding doubles to ddouble is what `np.add.reduce(x, dtype=ddouble)` for a
+ * double array `x` resolves to, so reductions are detected like in
+ * ULOOP_REDUCE and use the sumd kernel, which avoids casting `x`.
+ */
+static void u_addqd(char **args, const npy_intp *dimensions,
+                    const npy_intp* steps, void *data)
+{
+    if (args[0] != args[2] || steps[0] != 0 || steps[2] != 0) {
+        u_addqd_elementwise(args, dimensions, steps, data);
+        return;
+    }
+    ddouble *out = (ddouble *)args[2];
+    sumd_args red_args = {(const double *)args[1], steps[1] / sizeof(double)};
+    ddouble red = dd_parallel_reduce(&parallel, sumd_block, addqq, &red_args,
+                                     dimensions[0], 1);
+    *out = addqq(*out, red);
+}
+ULOOP_BINARY_VEC(u_divqq, divqq, divqq, 2, ddouble, ddouble, ddouble)
 ULOOP_BINARY(u_copysignqq, copysignqq, ddouble, ddouble, ddouble)
 ULOOP_BINARY(u_copysignqd, copysignqd, ddouble, ddouble, double)
 ULOOP_BINARY(u_copysigndq, copysigndq, ddouble, double, ddouble)
@@ -772,9 +1043,12 @@ ULOOP_BINARY(u_fminqd, fminqd, ddouble, ddouble, double)
 ULOOP_BINARY(u_fmaxqd, fmaxqd, ddouble, ddouble, double)
 ULOOP_BINARY(u_fmindq, fmindq, ddouble, double, ddouble)
 ULOOP_BINARY(u_fmaxdq, fmaxdq, ddouble, double, ddouble)
-ULOOP_BINARY(u_hypotqq, hypotqq, ddouble, ddouble, ddouble)
-ULOOP_BINARY(u_hypotdq, hypotdq, ddouble, double, ddouble)
-ULOOP_BINARY(u_hypotqd, hypotqd, ddouble, ddouble, double)
+ULOOP_BINARY(u_hypotqq_chunk, hypotqq, ddouble, ddouble, ddouble)
+ULOOP_BINARY(u_hypotdq_chunk, hypotdq, ddouble, double, ddouble)
+ULOOP_BINARY(u_hypotqd_chunk, hypotqd, ddouble, ddouble, double)
+ULOOP_PARALLEL(u_hypotqq, u_hypotqq_chunk, 2, 1, 10)
+ULOOP_PARALLEL(u_hypotdq, u_hypotdq_chunk, 2, 1, 10)
+ULOOP_PARALLEL(u_hypotqd, u_hypotqd_chunk, 2, 1, 10)
 
 ULOOP_UNARY(u_signbitq, signbitq, bool, ddouble)
 ULOOP_UNARY(u_signq, signq, ddouble, ddouble)
@@ -789,15 +1063,30 @@ ULOOP_UNARY(u_sqrq, sqrq, ddouble, ddouble)
 ULOOP_UNARY(u_roundq, roundq, ddouble, ddouble)
 ULOOP_UNARY(u_floorq, floorq, ddouble, ddouble)
 ULOOP_UNARY(u_ceilq, ceilq, ddouble, ddouble)
-ULOOP_UNARY(u_sqrtq, sqrtq, ddouble, ddouble)
-ULOOP_UNARY(u_expq, expq, ddouble, ddouble)
-ULOOP_UNARY(u_expm1q, expm1q, ddouble, ddouble)
-ULOOP_UNARY(u_logq, logq, ddouble, ddouble)
-ULOOP_UNARY(u_sinq, sinq, ddouble, ddouble)
-ULOOP_UNARY(u_cosq, cosq, ddouble, ddouble)
-ULOOP_UNARY(u_sinhq, sinhq, ddouble, ddouble)
-ULOOP_UNARY(u_coshq, coshq, ddouble, ddouble)
-ULOOP_UNARY(u_tanhq, tanhq, ddouble, ddouble)
+ULOOP_UNARY_KERNEL(u_sqrtq, sqrt, 6)
+ULOOP_UNARY_KERNEL(u_expq, exp, 60)
+ULOOP_UNARY_KERNEL(u_expm1q, expm1, 60)
+ULOOP_UNARY_KERNEL(u_logq, log, 40)
+ULOOP_UNARY_KERNEL(u_log2q, log2, 45)
+ULOOP_UNARY_KERNEL(u_log10q, log10, 50)
+ULOOP_UNARY_KERNEL(u_log1pq, log1p, 60)
+ULOOP_UNARY_KERNEL(u_sinq, sin, 60)
+ULOOP_UNARY_KERNEL(u_cosq, cos, 60)
+
+static void u_sincosq_chunk(char **args, const npy_intp *dimensions,
+                            const npy_intp *steps, void *data)
+{
+    kernels->sincos((const ddouble *)args[0], steps[0] / sizeof(ddouble),
+                    (ddouble *)args[1], steps[1] / sizeof(ddouble),
+                    (ddouble *)args[2], steps[2] / sizeof(ddouble),
+                    dimensions[0]);
+    MARK_UNUSED(data);
+}
+ULOOP_PARALLEL(u_sincosq, u_sincosq_chunk, 1, 2, 65)
+
+ULOOP_UNARY_KERNEL(u_sinhq, sinh, 75)
+ULOOP_UNARY_KERNEL(u_coshq, cosh, 70)
+ULOOP_UNARY_KERNEL(u_tanhq, tanh, 75)
 
 static bool register_binary(PyUFuncGenericFunction dq_func,
         PyUFuncGenericFunction qd_func, PyUFuncGenericFunction qq_func,
@@ -879,6 +1168,9 @@ static int register_ufuncs()
         && register_unary(u_expq, type_num, "exp")
         && register_unary(u_expm1q, type_num, "expm1")
         && register_unary(u_logq, type_num, "log")
+        && register_unary(u_log2q, type_num, "log2")
+        && register_unary(u_log10q, type_num, "log10")
+        && register_unary(u_log1pq, type_num, "log1p")
         && register_unary(u_sinq, type_num, "sin")
         && register_unary(u_cosq, type_num, "cos")
         && register_unary(u_sinhq, type_num, "sinh")
@@ -908,6 +1200,51 @@ static int register_ufuncs()
     return ok ? 0 : -1;
 }
 
+static int register_sincos()
+{
+    /* numpy has no sincos, so we need to make our own ufunc */
+    PyUFuncObject *ufunc = (PyUFuncObject *)PyUFunc_FromFuncAndData(
+                NULL, NULL, NULL, 0, 1, 2, PyUFunc_None, "sincos",
+                "Sine and cosine of the argument, computed together", 0);
+    if (ufunc == NULL)
+        return -1;
+
+    int arg_types[3] = {type_num, type_num, type_num};
+    if (PyUFunc_RegisterLoopForType(ufunc, type_num, u_sincosq,
+                                    arg_types, NULL) < 0) {
+        Py_DECREF(ufunc);
+        return -1;
+    }
+    return PyModule_AddObject(module, "sincos", (PyObject *)ufunc);
+}
+
+static int register_accurate()
+{
+    /* The result of dot2 and sum2 is returned as pair of doubles, since
+     * numpy only considers loops for user types that appear in the inputs.
+     * The Python wrappers view it as ddouble.
+     */
+    static PyUFuncGenericFunction dot2_funcs[] = {u_dot2};
+    static PyUFuncGenericFunction sum2_funcs[] = {u_sum2};
+    static char dot2_types[] = {NPY_DOUBLE, NPY_DOUBLE, NPY_DOUBLE};
+    static char sum2_types[] = {NPY_DOUBLE, NPY_DOUBLE};
+    static void *no_data[] = {NULL};
+
+    PyObject *dot2 = PyUFunc_FromFuncAndDataAndSignature(
+                dot2_funcs, no_data, dot2_types, 1, 2, 1, PyUFunc_None,
+                "dot2", "Accurate dot product of double vectors", 0,
+                "(i),(i)->(2)");
+    if (dot2 == NULL || PyModule_AddObject(module, "dot2", dot2) < 0)
+        return -1;
+
+    PyObject *sum2 = PyUFunc_FromFuncAndDataAndSignature(
+                sum2_funcs, no_data, sum2_types, 1, 1, 1, PyUFunc_None,
+                "sum2", "Accurate sum of a double vector", 0, "(i)->(2)");
+    if (sum2 == NULL)
+        return -1;
+    return PyModule_AddObject(module, "sum2", sum2);
+}
+
 int register_dtype_in_dicts()
 {
     PyObject *type_dict = NULL;
@@ -927,18 +1264,73 @@ error:
 
 /* ----------------------- Python stuff -------------------------- */
 
+static PyObject *dispatch_variant(PyObject *self, PyObject *_dummy)
+{
+    return PyUnicode_FromString(kernels->name);
+    MARK_UNUSED(self);
+    MARK_UNUSED(_dummy);
+}
+
+static PyObject *get_grain_size(PyObject *self, PyObject *_dummy)
+{
+    return PyLong_FromLong(parallel.grain_size);
+    MARK_UNUSED(self);
+    MARK_UNUSED(_dummy);
+}
+
+static PyObject *set_grain_size(PyObject *self, PyObject *arg)
+{
+    long value = PyLong_AsLong(arg);
+    if (value == -1 && PyErr_Occurred())
+        return NULL;
+    if (value < 1) {
+        PyErr_SetString(PyExc_ValueError, "grain size must be positive");
+        return NULL;
+    }
+    parallel.grain_size = value;
+    Py_RETURN_NONE;
+    MARK_UNUSED(self);
+}
+
+static PyObject *get_deterministic(PyObject *self, PyObject *_dummy)
+{
+    return PyBool_FromLong(parallel.deterministic);
+    MARK_UNUSED(self);
+    MARK_UNUSED(_dummy);
+}
+
+static PyObject *set_deterministic(PyObject *self, PyObject *arg)
+{
+    int value = PyObject_IsTrue(arg);
+    if (value < 0)
+        return NULL;
+    parallel.deterministic = value;
+    Py_RETURN_NONE;
+    MARK_UNUSED(self);
+}
+
 PyObject *make_module()
 {
     // Defitions
-    static PyMethodDef no_methods[] = {
-        {NULL, NULL, 0, NULL}    // No methods defined
+    static PyMethodDef methods[] = {
+        {"dispatch_variant", dispatch_variant, METH_NOARGS,
+         "instruction set variant of the kernels selected for this CPU"},
+        {"get_grain_size", get_grain_size, METH_NOARGS,
+         "minimum work per thread for elementwise operations"},
+        {"set_grain_size", set_grain_size, METH_O,
+         "set minimum work per thread for elementwise operations"},
+        {"get_deterministic", get_deterministic, METH_NOARGS,
+         "whether reductions are independent of the number of threads"},
+        {"set_deterministic", set_deterministic, METH_O,
+         "make reductions independent of the number of threads"},
+        {NULL, NULL, 0, NULL}
     };
     static struct PyModuleDef module_def = {
         PyModuleDef_HEAD_INIT,
         "_dd_ufunc",
         NULL,
         -1,
-        no_methods,
+        methods,
         NULL,
         NULL,
         NULL,
@@ -994,6 +1386,8 @@ PyMODINIT_FUNC PyInit__dd_ufunc(void)
     import_array();
     import_umath();
 
+    kernels = dd_select_kernels();
+
     if (make_ddouble_type() < 0)
         return NULL;
     if (make_dtype() < 0)
@@ -1017,11 +1411,22 @@ PyMODINIT_FUNC PyInit__dd_ufunc(void)
         return NULL;
     if (register_ufuncs() < 0)
         return NULL;
+    if (register_sincos() < 0)
+        return NULL;
+    if (register_accurate() < 0)
+        return NULL;
     if (register_dtype_in_dicts() < 0)
         return NULL;
     if (register_constants() < 0)
         return NULL;
 
+    PyObject *capsule = PyCapsule_New(&parallel, "xprec._dd_ufunc._parallel",
+                                      NULL);
+    if (capsule == NULL)
+        return NULL;
+    if (PyModule_AddObject(module, "_parallel", capsule) < 0)
+        return NULL;
+
     /* Module is ready */
     return module;
 }
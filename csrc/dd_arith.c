@@ -9,6 +9,8 @@
  */
 #include "dd_arith.h"
 
+#include <stdint.h>
+
 // 2**500 and 2**(-500);
 static const double LARGE = 3.273390607896142e+150;
 static const double INV_LARGE = 3.054936363499605e-151;
@@ -63,7 +65,6 @@ ddouble sqrtq(ddouble a)
 }
 
 /* Inverse Factorials from 1/3!, 1/4!, asf. */
-static int _n_inv_fact = 15;
 static const ddouble _inv_fact[] = {
     {1.66666666666666657e-01, 9.25185853854297066e-18},
     {4.16666666666666644e-02, 2.31296463463574266e-18},
@@ -82,6 +83,82 @@ static const ddouble _inv_fact[] = {
     {2.81145725434552060e-15, 1.65088427308614326e-31}
     };
 
+/* ln(2)/64, split into three parts such that k * _ln2_64[0] is exact for
+ * |k| < 2^20.
+ */
+static const double _ln2_64[] = {
+    1.08304246969055384e-02, -6.56392980106419468e-13, -2.05073412777894615e-29
+    };
+static const double _inv_ln2_64 = 92.33248261689366;
+
+/* Table of 2^(j/64) - 1 for j = -32, ..., 31. */
+static const ddouble _exp2m1_table[] = {
+    {-2.928932188134524828e-01, 7.174684663993261307e-18},
+    {-2.851933308040149884e-01, -6.015821244526827590e-18},
+    {-2.774095965114766749e-01, -1.511879067496993660e-17},
+    {-2.695411029096765332e-01, 2.750926530088174494e-17},
+    {-2.615869270302503269e-01, -1.741997278446397898e-17},
+    {-2.535461358543675825e-01, 7.096460077142017885e-18},
+    {-2.454177862032886348e-01, 4.688384843543075066e-18},
+    {-2.372009246277308470e-01, 3.864426695450208470e-19},
+    {-2.288945872960296002e-01, 1.199359843285919077e-17},
+    {-2.204977998810815076e-01, -8.849540348841276001e-18},
+    {-2.120095774460567517e-01, -5.068458235639151990e-18},
+    {-2.034289243288665561e-01, 5.039118519698010724e-18},
+    {-1.947548340253728583e-01, 1.235359628489894393e-17},
+    {-1.859862890713261108e-01, -5.809199807906506151e-18},
+    {-1.771222609230175826e-01, 4.882751662883964002e-18},
+    {-1.681617098366317842e-01, 1.699387867936585997e-18},
+    {-1.591035847462854702e-01, 1.323947448727857217e-17},
+    {-1.499468231407382612e-01, -4.011859685198850123e-18},
+    {-1.406903509387610329e-01, -9.256902091315554941e-18},
+    {-1.313330823631468636e-01, -1.193362911916412724e-17},
+    {-1.218739198133502594e-01, 9.229156694299103576e-19},
+    {-1.123117537367393781e-01, 4.393083367153945118e-18},
+    {-1.026454624984464020e-01, -4.764058593858412600e-18},
+    {-9.287391224980062754e-02, 5.663493536656079841e-18},
+    {-8.299595679532877079e-02, 2.537748313413678877e-18},
+    {-7.301043745830720910e-02, -6.701713777619857018e-18},
+    {-6.291618294485004648e-02, -2.858241449391796601e-18},
+    {-5.271200920651718247e-02, 3.139229868268192368e-18},
+    {-4.239671930142635548e-02, 2.411420950278012292e-18},
+    {-3.196910325385277779e-02, 3.089672476031033162e-18},
+    {-2.142793791229986519e-02, -2.989714202136460982e-19},
+    {-1.077198680602451525e-02, -6.223051570826016529e-19},
+    {0.000000000000000000e+00, 0.000000000000000000e+00},
+    {1.088928605170045964e-02, 3.777326804226854697e-19},
+    {2.189714865411667918e-02, -9.494539895697731261e-19},
+    {3.302487902122842184e-02, 6.619449701198604969e-19},
+    {4.427378242741383807e-02, 2.252170208492904153e-18},
+    {5.564517836055715705e-02, 1.759325738772091984e-18},
+    {6.714040067682361390e-02, 4.268187178470921620e-18},
+    {7.876079775711979092e-02, 2.822334678506354275e-18},
+    {9.050773266525766192e-02, -2.712245182495796033e-18},
+    {1.023825833078409464e-01, -2.850782515550882385e-18},
+    {1.143867425958925432e-01, -6.919517894059942952e-18},
+    {1.265216186082419036e-01, -3.852583643303260421e-18},
+    {1.387886347566916478e-01, 5.861399913367334935e-18},
+    {1.511892299529827011e-01, 4.751526573009359380e-18},
+    {1.637248587775775033e-01, 1.053647275361202148e-17},
+    {1.763969916502812763e-01, 3.088131092296111991e-20},
+    {1.892071150027210547e-01, 1.206457669902754914e-17},
+    {2.021567314527031312e-01, 1.093866376126518081e-17},
+    {2.152473599804688720e-01, 6.140419920071863845e-18},
+    {2.284805361068699969e-01, 8.767759302603613979e-18},
+    {2.418578120734840575e-01, -8.930875312888462190e-18},
+    {2.553807570246910963e-01, -6.711389821296878419e-18},
+    {2.690509571917332199e-01, 2.667932131342186095e-18},
+    {2.828700160787782636e-01, 1.713594918243560968e-17},
+    {2.968395546510096406e-01, 2.538250279488831496e-17},
+    {3.109612115247643582e-01, -1.630421012393671155e-17},
+    {3.252366431597412677e-01, 2.692383913086921329e-17},
+    {3.396675240533030271e-01, -2.174947651419833420e-17},
+    {3.542555469368927068e-01, 2.149833256677206451e-17},
+    {3.690024229745906270e-01, -1.508432327132717248e-17},
+    {3.839098819638319671e-01, -1.219396535669003585e-17},
+    {3.989796725383111253e-01, 1.488017037200242640e-17}
+    };
+
 /**
  * For the exponential of `a`, return compute tuple `x, m` such that:
  *
@@ -94,54 +171,52 @@ static ddouble _exp_reduced(ddouble a, int *m)
 {
     /* Strategy:  We first reduce the size of x by noting that
      *
-     *     exp(k * r + m * log(2)) = 2^m * exp(r)^k
+     *     exp(r + (64 * m + j) * log(2)/64) = 2^m * 2^(j/64) * exp(r)
      *
-     * where m and k are integers.  By choosing m appropriately
-     * we can make |k * r| <= log(2) / 2 = 0.347.
+     * where m and j are integers.  By choosing them appropriately, we
+     * can make |r| <= log(2)/128 = 0.0054 and |j| <= 32.  The reduction
+     * uses a three-part log(2)/64, so r is accurate even for large a.
      */
-    const double k = 512.0;
-    const double inv_k = 1.0 / k;
-    double mm = floor(a.hi / Q_LOG2.hi + 0.5);
-    ddouble r = mul_pwr2(subqq(a, mulqd(Q_LOG2, mm)), inv_k);
+    double k = floor(a.hi * _inv_ln2_64 + 0.5);
+    double mm = floor((k + 32.0) / 64.0);
+    int j = (int)(k - 64.0 * mm);
+    ddouble r = subqd(a, k * _ln2_64[0]);
+    r = subqq(r, two_prod(k, _ln2_64[1]));
+    r = subqd(r, k * _ln2_64[2]);
     *m = (int)mm;
 
-    /* Now, evaluate exp(r) using the familiar Taylor series.  Reducing the
-     * argument substantially speeds up the convergence.  First, we compute
-     * terms of order 1 and 2 and add it to the sum
+    /* Next, evaluate p = exp(r) - 1 using the Taylor series in Horner form.
+     * Terms of order 6 and up are below 4e-17 in magnitude, so we can
+     * compute them in double precision (and use double coefficients).
      */
-    ddouble sum, term, rpower;
-    rpower = sqrq(r);
-    sum = addqq(r, mul_pwr2(rpower, 0.5));
-
-    /* Next, compute terms of order 3 and up */
-    rpower = mulqq(rpower, r);
-    term = mulqq(rpower, _inv_fact[0]);
-    int i = 0;
-    do {
-        sum = addqq(sum, term);
-        rpower = mulqq(rpower, r);
-        ++i;
-        term = mulqq(rpower, _inv_fact[i]);
-    } while (fabs(term.hi) > inv_k * Q_EPS.hi && i < 5);
-    sum = addqq(sum, term);
-
-    /* We now have that approximately exp(r) == 1 + sum.  Raise that to
-     * the m'th (512) power by squaring the binomial nine times
+    double rd = r.hi;
+    double tail = _inv_fact[8].hi;
+    tail = _inv_fact[7].hi + rd * tail;
+    tail = _inv_fact[6].hi + rd * tail;
+    tail = _inv_fact[5].hi + rd * tail;
+    tail = _inv_fact[4].hi + rd * tail;
+    tail = _inv_fact[3].hi + rd * tail;
+    tail = rd * tail;
+
+    ddouble p = addqd(_inv_fact[2], tail);
+    p = addqq(_inv_fact[1], mulqq(p, r));
+    p = addqq(_inv_fact[0], mulqq(p, r));
+    p = addqd(mulqq(p, r), 0.5);
+    p = addqq(r, mulqq(sqrq(r), p));
+
+    /* Finally, combine with the table value e = 2^(j/64) - 1:
+     *
+     *     exp(r) * 2^(j/64) - 1 = e + p + e * p
      */
-    sum = addqq(mul_pwr2(sum, 2.0), sqrq(sum));
-    sum = addqq(mul_pwr2(sum, 2.0), sqrq(sum));
-    sum = addqq(mul_pwr2(sum, 2.0), sqrq(sum));
-    sum = addqq(mul_pwr2(sum, 2.0), sqrq(sum));
-    sum = addqq(mul_pwr2(sum, 2.0), sqrq(sum));
-    sum = addqq(mul_pwr2(sum, 2.0), sqrq(sum));
-    sum = addqq(mul_pwr2(sum, 2.0), sqrq(sum));
-    sum = addqq(mul_pwr2(sum, 2.0), sqrq(sum));
-    sum = addqq(mul_pwr2(sum, 2.0), sqrq(sum));
-    return sum;
+    ddouble e = _exp2m1_table[j + 32];
+    return addqq(e, addqq(p, mulqq(e, p)));
 }
 
 ddouble expq(ddouble a)
 {
+    /* NaN must not reach the table lookup in _exp_reduced() */
+    if (isnanq(a))
+        return nanq();
     if (a.hi <= -709.0)
         return Q_ZERO;
     if (a.hi >= 709.0)
@@ -161,6 +236,8 @@ ddouble expq(ddouble a)
 
 ddouble expm1q(ddouble a)
 {
+    if (isnanq(a))
+        return nanq();
     if (a.hi <= -709.0)
         return (ddouble){-1.0, 0.0};
     if (a.hi >= 709.0)
@@ -181,254 +258,581 @@ ddouble expm1q(ddouble a)
     return subqd(sum, 1.0);
 }
 
-ddouble logq(ddouble a)
+/* Table of log(i/128) for i = 90, ..., 182. */
+static const ddouble _log_table[] = {
+    {-3.522205935893520934e-01, -5.723331694918248467e-18},
+    {-3.411707574027671441e-01, 1.936679006260286699e-17},
+    {-3.302416868705768671e-01, 1.082832163748385790e-17},
+    {-3.194307707663612272e-01, -1.354256857264811075e-18},
+    {-3.087354816496132859e-01, 1.619918608514810224e-17},
+    {-2.981533723190763485e-01, 1.720695867445866037e-17},
+    {-2.876820724517809014e-01, -2.607160616442563976e-17},
+    {-2.773192854162343512e-01, 7.445284055835129676e-18},
+    {-2.670627852490452536e-01, 7.328915327320169489e-18},
+    {-2.569104137850272140e-01, -2.502843296152504048e-17},
+    {-2.468600779315257843e-01, -1.361743371748368017e-17},
+    {-2.369097470783577131e-01, -1.968240297839816367e-18},
+    {-2.270574506353460753e-01, -9.551415762738488431e-18},
+    {-2.173012756899813935e-01, -1.616845245376301536e-18},
+    {-2.076393647782444896e-01, -1.205324321668612895e-17},
+    {-1.980699137620937911e-01, -3.742843482461439014e-18},
+    {-1.885911698075500298e-01, 7.432164219196925053e-18},
+    {-1.792014294577110034e-01, 1.078501745485842302e-17},
+    {-1.698990367953974734e-01, 4.868008764439070794e-19},
+    {-1.606823816904734692e-01, 3.650183553047837117e-18},
+    {-1.515498981272009327e-01, -5.166959368461559440e-18},
+    {-1.425000626072830401e-01, 9.926388234225749140e-18},
+    {-1.335313926245226268e-01, 3.664457663660084744e-18},
+    {-1.246424452072766031e-01, 5.808912678940970714e-18},
+    {-1.158318155251217008e-01, -4.338484369808095956e-18},
+    {-1.070981355563671023e-01, 1.737051040159060010e-18},
+    {-9.844007281325252434e-02, 4.439009633675135877e-18},
+    {-8.985632912186104770e-02, 6.273760163689594022e-19},
+    {-8.134563945395240081e-02, -5.077076355931169930e-18},
+    {-7.290677080808778687e-02, 6.306860257532777777e-18},
+    {-6.453852113757117814e-02, 6.470486661692932997e-18},
+    {-5.623971832287608108e-02, 3.283514980560561291e-18},
+    {-4.800921918636060631e-02, -1.439090334729220470e-18},
+    {-3.984590854719967379e-02, 3.129547680315208094e-18},
+    {-3.174869831458029812e-02, -3.038226308468085788e-18},
+    {-2.371652661731604370e-02, 1.577424348866821450e-18},
+    {-1.574835696813916761e-02, -1.002157863052897367e-18},
+    {-7.843177461025892597e-03, -2.764708154124903791e-19},
+    {0.000000000000000000e+00, 0.000000000000000000e+00},
+    {7.782140442054948960e-03, -1.281917912334384503e-20},
+    {1.550418653596525448e-02, -3.278321022892429130e-19},
+    {2.316705928153437941e-02, -1.176954493206330504e-18},
+    {3.077165866675368733e-02, 1.043173202900596781e-18},
+    {3.831886430213660155e-02, -2.357996157351286117e-18},
+    {4.580953603129420126e-02, 1.902959866474257063e-18},
+    {5.324451451881228453e-02, -1.665575816973662918e-18},
+    {6.062462181643483994e-02, 2.642402593872693418e-18},
+    {6.795066190850775067e-02, -1.280214124061173260e-18},
+    {7.522342123758753163e-02, -5.930604196293240717e-18},
+    {8.244366921107458557e-02, 5.700437773813987194e-18},
+    {8.961215868968713805e-02, -5.426812933664713534e-18},
+    {9.672962645855111286e-02, -5.597397486289964775e-19},
+    {1.037967936816435593e-01, 5.477724157266590126e-18},
+    {1.108143663402901130e-01, 1.183748342825648911e-18},
+    {1.177830356563834557e-01, -1.197168574759367730e-18},
+    {1.247034785009572405e-01, -4.652260963649662402e-18},
+    {1.315763577887192615e-01, 1.112300087972958803e-17},
+    {1.384023228591191312e-01, 4.447777301357526853e-18},
+    {1.451820098444978890e-01, 8.242418783022475390e-18},
+    {1.519160420258419686e-01, 6.483863124402219389e-18},
+    {1.586050301766385728e-01, 1.125700387218259224e-17},
+    {1.652495728953071730e-01, -1.009493562232262752e-17},
+    {1.718502569266592284e-01, -6.022453821011370476e-18},
+    {1.784076574728183096e-01, -1.243255378870113107e-17},
+    {1.849223384940119896e-01, 3.023661415357406427e-18},
+    {1.913948529996294667e-01, -1.212949690579288407e-17},
+    {1.978257433299198675e-01, 1.282119437298014193e-17},
+    {2.042155414286908888e-01, 2.733828101872277273e-18},
+    {2.105647691073496419e-01, -4.249405314729895329e-18},
+    {2.168739383006143551e-01, 4.551026193234283188e-18},
+    {2.231435513142097649e-01, -9.091270597324799049e-18},
+    {2.293741010648458201e-01, 9.927671823978025492e-18},
+    {2.355660713127669115e-01, -2.394337149518735460e-18},
+    {2.417199368871451592e-01, 8.900990022166642579e-18},
+    {2.478361639045812692e-01, -1.243220957870252318e-17},
+    {2.539152099809634522e-01, -8.048097394424201305e-18},
+    {2.599575244369260463e-01, 2.069806938978935026e-17},
+    {2.659635484971379360e-01, 5.339380276131431449e-18},
+    {2.719337154836417580e-01, 7.833196376974420124e-19},
+    {2.778684510034563071e-01, -9.160182949092630843e-19},
+    {2.837681731306446187e-01, -2.032665581126656123e-17},
+    {2.896332925830426563e-01, 2.053595321985817415e-17},
+    {2.954642128938358980e-01, -2.164610860405989966e-17},
+    {3.012613305781617901e-01, -9.048511144048563612e-18},
+    {3.070250352949118744e-01, -1.231991620010196428e-17},
+    {3.127557100038969029e-01, -1.451808353098951104e-17},
+    {3.184537311185345887e-01, 2.711477936732623596e-17},
+    {3.241194686542119840e-01, -7.958214381893812566e-18},
+    {3.297532863724679797e-01, 2.122020616196946023e-18},
+    {3.353555419211378119e-01, 1.834564437059472968e-17},
+    {3.409265869705931928e-01, 1.746713644354474712e-17},
+    {3.464667673462085706e-01, 1.028583585496265067e-17},
+    {3.519764231571781976e-01, -1.295389303019196290e-17}
+    };
+
+/* Coefficients 1/3 and 1/5 of the series for atanh */
+static const ddouble _inv_3 = {3.333333333333333148e-01, 1.850371707708594131e-17};
+static const ddouble _inv_5 = {2.000000000000000111e-01, -1.110223024625156602e-17};
+
+/**
+ * Return log((1 + u) / (1 - u)) = 2 * atanh(u) for small `u`.
+ *
+ * The series is only accurate to full precision for abs(u) <= 2**-9.
+ */
+static ddouble _log_series(ddouble u)
 {
-    /* Strategy.  The Taylor series for log converges much more
-     * slowly than that of exp, due to the lack of the factorial
-     * term in the denominator.  Hence this routine instead tries
-     * to determine the root of the function
+    /* The series is
      *
-     *     f(x) = exp(x) - a
+     *     2 atanh(u) = 2u + 2u * s * (1/3 + s/5 + s^2/7 + ...),   s = u^2.
      *
-     * using Newton iteration.  The iteration is given by
+     * Since s <= 2**-18, terms of order s^2 and up are below 2**-36 relative
+     * to the leading one, so we can compute them in double precision.
+     */
+    ddouble s = sqrq(u);
+    double sd = s.hi;
+    double tail = 1.0/13;
+    tail = 1.0/11 + sd * tail;
+    tail = 1.0/9 + sd * tail;
+    tail = 1.0/7 + sd * tail;
+    tail = sd * sd * tail;
+
+    ddouble p = addqd(addqq(_inv_3, mulqq(s, _inv_5)), tail);
+    p = mulqq(mulqq(u, s), p);
+    return mul_pwr2(addqq(u, p), 2.0);
+}
+
+/**
+ * For the logarithm of positive, finite `a`, return `e` and `log(m)` such
+ * that:
+ *
+ *      log(a) = e * log(2) + log(m),
+ *
+ * where `m` is in [sqrt(1/2), sqrt(2)].  The value `log(m)` is returned,
+ * whereas the value `e` is given as an out parameter.
+ */
+static ddouble _log_reduced(ddouble a, int *e)
+{
+    /* Strategy:  We choose c = i/128 as the point closest to m on a grid,
+     * so that we can look up log(c) and |m/c - 1| <= 2**-8.  Then:
      *
-     *     x' = x - f(x)/f'(x)
-     *        = x - (1 - a * exp(-x))
-     *        = x + a * exp(-x) - 1.
+     *     log(m) = log(c) + log(m/c) = log(c) + 2 atanh((m - c)/(m + c)),
      *
-     * Only one iteration is needed, since Newton's iteration
-     * approximately doubles the number of digits per iteration.
+     * and the argument of atanh is small enough for the series to converge
+     * rapidly.  Centering the interval of m around one ensures there is no
+     * cancellation between the two terms of log(a) for a close to one.
      */
+    double mhi = frexp(a.hi, e);
+    if (mhi < 0.7071067811865476) {
+        mhi *= 2;
+        *e -= 1;
+    }
+    ddouble m = ldexpq(a, -*e);
+
+    /* c = i/128 is exact and m.hi - c is exact by Sterbenz' lemma */
+    int i = (int)floor(m.hi * 128.0 + 0.5);
+    double c = i / 128.0;
+    ddouble u = divqq(subqd(m, c), addqd(m, c));
+    return addqq(_log_table[i - 90], _log_series(u));
+}
+
+ddouble logq(ddouble a)
+{
     if (isoneq(a))
         return Q_ZERO;
-    if (a.hi <= 0.0)
+    if (iszeroq(a))
+        return negq(infq());
+    if (!(a.hi > 0.0))
         return nanq();
+    if (isinfq(a))
+        return a;
 
-    ddouble x = {log(a.hi), 0.0}; /* Initial approximation */
-    x = subqd(addqq(x, mulqq(a, expq(negq(x)))), 1.0);
-    return x;
+    int e;
+    ddouble x = _log_reduced(a, &e);
+    return addqq(muldq((double)e, Q_LOG2), x);
 }
 
-static const ddouble _pi_16 =
-    {1.963495408493620697e-01, 7.654042494670957545e-18};
-
-/* Table of sin(k * pi/16) and cos(k * pi/16). */
-static const ddouble _sin_table[] = {
-    {1.950903220161282758e-01, -7.991079068461731263e-18},
-    {3.826834323650897818e-01, -1.005077269646158761e-17},
-    {5.555702330196021776e-01, 4.709410940561676821e-17},
-    {7.071067811865475727e-01, -4.833646656726456726e-17}
-    };
+ddouble log2q(ddouble a)
+{
+    if (iszeroq(a))
+        return negq(infq());
+    if (!(a.hi > 0.0))
+        return nanq();
+    if (isinfq(a))
+        return a;
 
-static const ddouble _cos_table[] = {
-    {9.807852804032304306e-01, 1.854693999782500573e-17},
-    {9.238795325112867385e-01, 1.764504708433667706e-17},
-    {8.314696123025452357e-01, 1.407385698472802389e-18},
-    {7.071067811865475727e-01, -4.833646656726456726e-17}
-    };
+    /* Handling the exponent separately keeps powers of two exact */
+    int e;
+    ddouble x = _log_reduced(a, &e);
+    return adddq((double)e, mulqq(x, Q_1_LOG2));
+}
 
-static ddouble sin_taylor(ddouble a)
+ddouble log10q(ddouble a)
 {
-    const double thresh = 0.5 * fabs(a.hi) * Q_EPS.hi;
-    ddouble r, s, t, x;
+    ddouble x = logq(a);
+    if (!isfiniteq(x))
+        return x;
+    return mulqq(x, Q_1_LOG10);
+}
 
+ddouble log1pq(ddouble a)
+{
     if (iszeroq(a))
-        return Q_ZERO;
+        return a;
+    if (a.hi == -1.0 && a.lo == 0.0)
+        return negq(infq());
+    if (!(a.hi >= -1.0))
+        return nanq();
+    if (isinfq(a))
+        return a;
 
-    int i = 0;
-    x = negq(sqrq(a));
-    s = a;
-    r = a;
-    do {
-        r = mulqq(r, x);
-        t = mulqq(r, _inv_fact[i]);
-        s = addqq(s, t);
-        i += 2;
-    } while (i < _n_inv_fact && fabs(t.hi) > thresh);
+    /* For small a, log(1 + a) = 2 atanh(a / (2 + a)) avoids rounding 1 + a */
+    if (fabs(a.hi) < 0.0039)
+        return _log_series(divqq(a, adddq(2.0, a)));
 
-    return s;
+    /* Otherwise, take the logarithm of x = 1 + a and correct for the error
+     * d = (1 + a) - x made in the rounding, using log(x + d) ~ log(x) + d/x.
+     * The subtraction x - 1 is exact for x in [1/2, 2].
+     */
+    ddouble x = adddq(1.0, a);
+    ddouble d = subqq(a, subqd(x, 1.0));
+    return addqd(logq(x), d.hi / x.hi);
 }
 
-static ddouble cos_taylor(ddouble a)
-{
-    const double thresh = 0.5 * Q_EPS.hi;
-    ddouble r, s, t, x;
+/* Bits of 2/pi in 32-bit words, most significant first, i.e.,
+ *
+ *     2/pi = sum_j _two_over_pi_bits[j] * 2**(-32 * (j + 1))
+ *
+ * This is enough for the reduction of any finite double.
+ */
+static const int _n_two_over_pi_bits = 40;
+static const uint32_t _two_over_pi_bits[] = {
+    0xa2f9836e, 0x4e441529, 0xfc2757d1, 0xf534ddc0, 0xdb629599,
+    0x3c439041, 0xfe5163ab, 0xdebbc561, 0xb7246e3a, 0x424dd2e0,
+    0x06492eea, 0x09d1921c, 0xfe1deb1c, 0xb129a73e, 0xe88235f5,
+    0x2ebb4484, 0xe99c7026, 0xb45f7e41, 0x3991d639, 0x835339f4,
+    0x9c845f8b, 0xbdf9283b, 0x1ff897ff, 0xde05980f, 0xef2f118b,
+    0x5a0a6d1f, 0x6d367ecf, 0x27cb09b7, 0x4f463f66, 0x9e5fea2d,
+    0x7527bac7, 0xebe5f17b, 0x3d0739f7, 0x8a5292ea, 0x6bfb5fb1,
+    0x1f8d5d08, 0x56033046, 0xfc7b6bab, 0xf0cfbc20, 0x9af4361d
+    };
 
-    if (iszeroq(a))
-        return Q_ONE;
+/* Number of 32-bit words in the fraction of the fixed-point accumulator */
+#define PH_WORDS 7
 
-    x = negq(sqrq(a));
-    r = x;
-    s = adddq(1.0, mul_pwr2(r, 0.5));
-    int i = 1;
-    do {
-        r = mulqq(r, x);
-        t = mulqq(r, _inv_fact[i]);
-        s = addqq(s, t);
-        i += 2;
-    } while (i < _n_inv_fact && fabs(t.hi) > thresh);
+/**
+ * Add `x * 2/pi` modulo 4 to a fixed-point number.
+ *
+ * `acc[0]` holds the integer part (only its lowest two bits are meaningful)
+ * and `acc[i]` holds the bits of the fraction weighted by `2**(-32 * i)`.
+ */
+static void _add_two_over_pi(double x, uint32_t acc[PH_WORDS + 1])
+{
+    /* Write |x| = M * 2**(32 * q + s), where 0 <= s < 32, so that M * 2**s
+     * fits into three words.  The product with 2/pi can then be formed by
+     * schoolbook multiplication on word boundaries.
+     */
+    int e;
+    double m = frexp(fabs(x), &e);
+    if (m == 0.0)
+        return;
+
+    int q = (int)floor((e - 53) / 32.0);
+    int s = e - 53 - 32 * q;
+    uint64_t mant = (uint64_t)ldexp(m, 53);
+    uint32_t xw[3] = {
+        (uint32_t)(mant << s),
+        (uint32_t)(mant >> (32 - s)),
+        (uint32_t)(s != 0 ? mant >> (64 - s) : 0)
+        };
+
+    /* Word w of x times word j of 2/pi has weight 2**(-32 * i), where
+     * i = j + 1 - w - q.  Words of weight 2**32 and up are multiples of 4
+     * and can be dropped.
+     */
+    uint64_t sum[PH_WORDS + 1] = {0};
+    for (int w = 0; w != 3; ++w) {
+        for (int i = 0; i <= PH_WORDS; ++i) {
+            int j = i - 1 + w + q;
+            if (j < 0 || j >= _n_two_over_pi_bits)
+                continue;
+
+            uint64_t p = (uint64_t)xw[w] * _two_over_pi_bits[j];
+            sum[i] += p & 0xffffffffU;
+            if (i > 0)
+                sum[i - 1] += p >> 32;
+        }
+    }
+    for (int i = PH_WORDS; i > 0; --i) {
+        sum[i - 1] += sum[i] >> 32;
+        sum[i] &= 0xffffffffU;
+    }
 
-    return s;
+    /* Negative numbers are added in two's complement */
+    uint64_t carry = 0;
+    if (x < 0) {
+        carry = 1;
+        for (int i = 0; i <= PH_WORDS; ++i)
+            sum[i] = ~sum[i] & 0xffffffffU;
+    }
+    for (int i = PH_WORDS; i >= 0; --i) {
+        carry += (uint64_t)acc[i] + sum[i];
+        acc[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
 }
 
-static void sincos_taylor(ddouble a, ddouble *sin_a, ddouble *cos_a)
+/**
+ * Payne-Hanek reduction of `a` modulo pi/2 for large `a`.
+ *
+ * Multiplies `a` with 2/pi in fixed-point arithmetic, keeping only the bits
+ * relevant modulo 4, such that no precision is lost for large `a`.
+ */
+static ddouble _reduce_pi_2_large(ddouble a, int *n)
 {
-    if (iszeroq(a)) {
-        *sin_a = Q_ZERO;
-        *cos_a = Q_ONE;
-    } else {
-        *sin_a = sin_taylor(a);
-        *cos_a = sqrtq(subdq(1.0, sqrq(*sin_a)));
+    uint32_t acc[PH_WORDS + 1] = {0};
+    _add_two_over_pi(a.hi, acc);
+    _add_two_over_pi(a.lo, acc);
+
+    /* Round to the nearest quadrant: if the fraction is 1/2 or larger,
+     * go to the next quadrant and negate the fraction.
+     */
+    int quadrant = acc[0] & 3;
+    bool negative = acc[1] >> 31;
+    if (negative) {
+        uint64_t carry = 1;
+        for (int i = PH_WORDS; i > 0; --i) {
+            carry += (uint32_t)~acc[i];
+            acc[i] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        quadrant += 1;
     }
+
+    ddouble f = Q_ZERO;
+    for (int i = PH_WORDS; i > 0; --i)
+        f = addqd(f, ldexp((double)acc[i], -32 * i));
+    if (negative)
+        f = negq(f);
+
+    *n = quadrant & 3;
+    return mulqq(f, Q_PI_2);
 }
 
-ddouble sinq(ddouble a)
+/* pi/128, split into four parts such that q * _pi_128[i] can be formed
+ * exactly using two_prod.
+ */
+static const double _pi_128[] = {
+    2.454369260617025872e-02, 9.567553118338696931e-19,
+    -2.339663913842452864e-35, 8.691048600495041262e-52
+    };
+static const double _inv_pi_128 = 40.74366543152521;
+static const ddouble _pi_128_q = {2.454369260617025872e-02, 9.567553118338696931e-19};
+
+/**
+ * Reduce `a` modulo pi/128, i.e., return `t` and `j` such that:
+ *
+ *      a = t + (256 * k + j) * pi/128,
+ *
+ * where `abs(t) <= pi/256` and `j` is in 0, ..., 255.  The value `t` is
+ * returned, whereas the value `j` is given as an out parameter.
+ */
+static ddouble _reduce_pi_128(ddouble a, int *j)
 {
-    /* Strategy.  To compute sin(x), we choose integers a, b so that
-     *
-     *   x = s + a * (pi/2) + b * (pi/16)
-     *
-     * and |s| <= pi/32.  Using the fact that
-     *
-     *   sin(pi/16) = 0.5 * sqrt(2 - sqrt(2 + sqrt(2)))
-     *
-     * we can compute sin(x) from sin(s), cos(s).  This greatly
-     * increases the convergence of the sine Taylor series.
+    /* For moderate arguments, use Cody-Waite reduction with a four-part
+     * pi/128.  Since q is below 2**26, the error in t is below 2**-130.
      */
-    if (iszeroq(a))
-        return Q_ZERO;
+    if (fabs(a.hi) <= 1048576.0) {
+        double q = floor(a.hi * _inv_pi_128 + 0.5);
+        ddouble t = subqq(a, two_prod(q, _pi_128[0]));
+        t = subqq(t, two_prod(q, _pi_128[1]));
+        t = subqq(t, two_prod(q, _pi_128[2]));
+        t = subqd(t, q * _pi_128[3]);
+        *j = (int)(q - 256.0 * floor(q / 256.0));
+        return t;
+    }
 
-    // approximately reduce modulo 2*pi
-    ddouble z = roundq(divqq(a, Q_2PI));
-    ddouble r = subqq(a, mulqq(Q_2PI, z));
-
-    // approximately reduce modulo pi/2 and then modulo pi/16.
-    ddouble t;
-    double q = floor(r.hi / Q_PI_2.hi + 0.5);
-    t = subqq(r, mulqd(Q_PI_2, q));
-    int j = (int)q;
-    q = floor(t.hi / _pi_16.hi + 0.5);
-    t = subqq(t, mulqd(_pi_16, q));
-    int k = (int)q;
-    int abs_k = abs(k);
-
-    if (j < -2 || j > 2)
-        return nanq();
+    /* Otherwise, reduce modulo pi/2 first, and then the remainder further */
+    int n;
+    ddouble r = _reduce_pi_2_large(a, &n);
+    double q = floor(r.hi * _inv_pi_128 + 0.5);
+    *j = (64 * n + (int)q + 256) % 256;
+    return subqq(r, mulqd(_pi_128_q, q));
+}
 
-    if (abs_k > 4)
-        return nanq();
+/* Table of sin(k * pi/128) and cos(k * pi/128) for k = 0, ..., 32. */
+static const ddouble _sin_table[] = {
+    {0.000000000000000000e+00, 0.000000000000000000e+00},
+    {2.454122852291228812e-02, -9.186849012577878175e-20},
+    {4.906767432741801493e-02, -6.796103720518280113e-19},
+    {7.356456359966742631e-02, -2.778494150627359327e-18},
+    {9.801714032956060363e-02, -1.634582362244255987e-18},
+    {1.224106751992161957e-01, 2.835450148996533534e-18},
+    {1.467304744553617479e-01, 3.726947147046567748e-18},
+    {1.709618887603012172e-01, 9.191998018175909444e-18},
+    {1.950903220161282758e-01, -7.991079068461731263e-18},
+    {2.191012401568697976e-01, -3.651381229915077582e-19},
+    {2.429801799032638987e-01, -8.751431529719663157e-18},
+    {2.667127574748983654e-01, 2.094122257882668842e-17},
+    {2.902846772544623866e-01, -1.892797870777425146e-17},
+    {3.136817403988914621e-01, 1.456044729996891224e-17},
+    {3.368898533922200511e-01, -4.200094003347509235e-19},
+    {3.598950365349881664e-01, -1.760168712383928250e-17},
+    {3.826834323650897818e-01, -1.005077269646158761e-17},
+    {4.052413140049898610e-01, 9.911140194289988416e-18},
+    {4.275550934302820849e-01, 9.411189816295472617e-18},
+    {4.496113296546065952e-01, 4.883192423203524350e-18},
+    {4.713967368259976420e-01, 6.516678136069012964e-18},
+    {4.928981922297840379e-01, -1.025783167656218554e-18},
+    {5.141027441932217723e-01, -4.571270752361562395e-17},
+    {5.349976198870972643e-01, -5.368313270835813399e-17},
+    {5.555702330196021776e-01, 4.709410940561676821e-17},
+    {5.758081914178453387e-01, -3.790949545894273413e-17},
+    {5.956993044924333569e-01, -1.343864193657946724e-17},
+    {6.152315905806268193e-01, 2.623141776726695025e-17},
+    {6.343932841636454878e-01, 1.042090192928003458e-17},
+    {6.531728429537767555e-01, 8.569564206002623800e-18},
+    {6.715589548470184411e-01, -4.048903774929669246e-17},
+    {6.895405447370669405e-01, -1.588932329480678990e-17},
+    {7.071067811865475727e-01, -4.833646656726456726e-17}
+    };
 
-    if (k == 0) {
-        switch (j)
-        {
-        case 0:
-            return sin_taylor(t);
-        case 1:
-            return cos_taylor(t);
-        case -1:
-            return negq(cos_taylor(t));
-        default:
-            return negq(sin_taylor(t));
-        }
-    }
+static const ddouble _cos_table[] = {
+    {1.000000000000000000e+00, 3.783157637138541077e-82},
+    {9.996988186962042500e-01, -2.985148640379975291e-17},
+    {9.987954562051724050e-01, -1.229169333707546480e-17},
+    {9.972904566786902070e-01, 9.164769537110173457e-18},
+    {9.951847266721969287e-01, -4.248691367830440960e-17},
+    {9.924795345987099671e-01, 3.109305509542890606e-17},
+    {9.891765099647810144e-01, -4.098730993704711138e-17},
+    {9.852776423889412216e-01, 2.315563702790020670e-17},
+    {9.807852804032304306e-01, 1.854693999782500573e-17},
+    {9.757021300385285700e-01, -2.557255608125968565e-17},
+    {9.700312531945439742e-01, 1.836530034842884439e-17},
+    {9.637760657954398402e-01, 2.646395056122002878e-17},
+    {9.569403357322088244e-01, 4.055386986187570055e-17},
+    {9.495281805930366748e-01, -7.554415192804329840e-18},
+    {9.415440651830208063e-01, -2.789637954769834107e-17},
+    {9.329927988347388457e-01, 4.204141555538435538e-17},
+    {9.238795325112867385e-01, 1.764504708433667706e-17},
+    {9.142097557035306910e-01, -3.631618252781442301e-17},
+    {9.039892931234433382e-01, -6.609754468748430850e-18},
+    {8.932243011955153245e-01, -4.116123915190891269e-18},
+    {8.819212643483550496e-01, -1.984324840589056214e-17},
+    {8.700869911087114605e-01, -4.188851086854996823e-17},
+    {8.577286100002721181e-01, -4.818344793633662014e-17},
+    {8.448535652497071169e-01, -4.363136029687963712e-17},
+    {8.314696123025452357e-01, 1.407385698472802389e-18},
+    {8.175848131515837114e-01, -1.488314981242677174e-17},
+    {8.032075314806449429e-01, -3.306060980481490961e-17},
+    {7.883464276266062276e-01, 3.439699315405970760e-17},
+    {7.730104533627369934e-01, -3.256590703364977234e-17},
+    {7.572088465064845675e-01, -1.990909877733550186e-17},
+    {7.409511253549591059e-01, -1.470861695229734518e-17},
+    {7.242470829514668917e-01, 2.919847133440300436e-17},
+    {7.071067811865475727e-01, -4.833646656726456726e-17}
+    };
 
-    ddouble u = _cos_table[abs_k - 1];
-    ddouble v = _sin_table[abs_k - 1];
-    ddouble sin_x, cos_x;
-    sincos_taylor(t, &sin_x, &cos_x);
-    if (j == 0) {
-        if (k > 0)
-            r = addqq(mulqq(u, sin_x), mulqq(v, cos_x));
-        else
-            r = subqq(mulqq(u, sin_x), mulqq(v, cos_x));
-    } else if (j == 1) {
-        if (k > 0)
-            r = subqq(mulqq(u, cos_x), mulqq(v, sin_x));
-        else
-            r = addqq(mulqq(u, cos_x), mulqq(v, sin_x));
-    } else if (j == -1) {
-        if (k > 0)
-            r = subqq(mulqq(v, sin_x), mulqq(u, cos_x));
-        else if (k < 0)   /* NOTE! */
-            r = subqq(mulqq(negq(u), cos_x), mulqq(v, sin_x));
-    } else {
-        if (k > 0)
-            r = subqq(mulqq(negq(u), sin_x), mulqq(v, cos_x));
-        else
-            r = subqq(mulqq(v, cos_x), mulqq(u, sin_x));
-    }
-    return r;
+/**
+ * Compute sine and cosine of `t` for `abs(t) <= pi/256`.
+ */
+static void _sincos_taylor(ddouble t, ddouble *sin_t, ddouble *cos_t)
+{
+    /* Taylor series in y = -t^2 in Horner form.  As for exp, the terms of
+     * order 8 and up are below 1e-17 relative to the leading one, so we
+     * compute them in double precision.
+     */
+    ddouble y = negq(sqrq(t));
+    double yd = y.hi;
+
+    /* sin(t) = t + t * y * (1/3! + y/5! + y^2/7! + ...) */
+    double tail = _inv_fact[10].hi;
+    tail = _inv_fact[8].hi + yd * tail;
+    tail = _inv_fact[6].hi + yd * tail;
+    tail = yd * tail;
+
+    ddouble p = addqd(_inv_fact[4], tail);
+    p = addqq(_inv_fact[2], mulqq(p, y));
+    p = addqq(_inv_fact[0], mulqq(p, y));
+    *sin_t = addqq(t, mulqq(mulqq(t, y), p));
+
+    /* cos(t) = 1 + y * (1/2 + y/4! + y^2/6! + ...) */
+    tail = _inv_fact[9].hi;
+    tail = _inv_fact[7].hi + yd * tail;
+    tail = _inv_fact[5].hi + yd * tail;
+    tail = yd * tail;
+
+    p = addqd(_inv_fact[3], tail);
+    p = addqq(_inv_fact[1], mulqq(p, y));
+    p = addqd(mulqq(p, y), 0.5);
+    *cos_t = adddq(1.0, mulqq(y, p));
 }
 
-ddouble cosq(ddouble a)
+void sincosq(ddouble a, ddouble *sin_a, ddouble *cos_a)
 {
-    if (iszeroq(a))
-        return Q_ONE;
+    /* Strategy.  To compute sin(x), we choose integers n, k so that
+     *
+     *   x = t + n * (pi/2) + k * (pi/128)
+     *
+     * and |t| <= pi/256, |k| <= 32.  sin(t) and cos(t) then follow from
+     * a rapidly converging Taylor series, and the other terms are read from
+     * tables and combined using the angle sum identities.  Both sine and
+     * cosine are needed in the general case, so computing both costs next
+     * to nothing extra.
+     */
+    if (iszeroq(a)) {
+        *sin_a = a;
+        *cos_a = Q_ONE;
+        return;
+    }
+    if (!isfiniteq(a)) {
+        *sin_a = *cos_a = nanq();
+        return;
+    }
 
-    // approximately reduce modulo 2*pi
-    ddouble z = roundq(divqq(a, Q_2PI));
-    ddouble r = subqq(a, mulqq(Q_2PI, z));
-
-    // approximately reduce modulo pi/2 and then modulo pi/16.
-    ddouble t;
-    double q = floor(r.hi / Q_PI_2.hi + 0.5);
-    t = subqq(r, mulqd(Q_PI_2, q));
-    int j = (int)q;
-    q = floor(t.hi / _pi_16.hi + 0.5);
-    t = subqq(t, mulqd(_pi_16, q));
-    int k = (int)q;
-    int abs_k = abs(k);
-
-    if (j < -2 || j > 2)
-        return nanq();
+    int j;
+    ddouble t = _reduce_pi_128(a, &j);
+    int n = (j + 32) / 64;
+    int k = j - 64 * n;
+    n %= 4;
 
-    if (abs_k > 4)
-        return nanq();
+    ddouble sin_t, cos_t;
+    _sincos_taylor(t, &sin_t, &cos_t);
 
+    ddouble sin_r, cos_r;
     if (k == 0) {
-        switch (j) {
-        case 0:
-            return cos_taylor(t);
-        case 1:
-            return negq(sin_taylor(t));
-        case -1:
-            return sin_taylor(t);
-        default:
-            return negq(cos_taylor(t));
-        }
+        sin_r = sin_t;
+        cos_r = cos_t;
+    } else {
+        ddouble u = _cos_table[abs(k)];
+        ddouble v = _sin_table[abs(k)];
+        if (k < 0)
+            v = negq(v);
+        sin_r = addqq(mulqq(v, cos_t), mulqq(u, sin_t));
+        cos_r = subqq(mulqq(u, cos_t), mulqq(v, sin_t));
     }
 
-    ddouble sin_x, cos_x;
-    sincos_taylor(t, &sin_x, &cos_x);
-    ddouble u = _cos_table[abs_k - 1];
-    ddouble v = _sin_table[abs_k - 1];
-
-    if (j == 0) {
-        if (k > 0)
-            r = subqq(mulqq(u, cos_x), mulqq(v, sin_x));
-        else
-            r = addqq(mulqq(u, cos_x), mulqq(v, sin_x));
-    } else if (j == 1) {
-        if (k > 0)
-            r = subqq(mulqq(negq(u), sin_x), mulqq(v, cos_x));
-        else
-            r = subqq(mulqq(v, cos_x), mulqq(u, sin_x));
-    } else if (j == -1) {
-        if (k > 0)
-            r = addqq(mulqq(u, sin_x), mulqq(v, cos_x));
-        else
-            r = subqq(mulqq(u, sin_x), mulqq(v, cos_x));
-    } else {
-        if (k > 0)
-            r = subqq(mulqq(v, sin_x), mulqq(u, cos_x));
-        else
-            r = subqq(mulqq(negq(u), cos_x), mulqq(v, sin_x));
+    switch (n) {
+    case 0:
+        *sin_a = sin_r;
+        *cos_a = cos_r;
+        break;
+    case 1:
+        *sin_a = cos_r;
+        *cos_a = negq(sin_r);
+        break;
+    case 2:
+        *sin_a = negq(sin_r);
+        *cos_a = negq(cos_r);
+        break;
+    default:
+        *sin_a = negq(cos_r);
+        *cos_a = sin_r;
     }
-    return r;
+}
+
+ddouble sinq(ddouble a)
+{
+    ddouble sin_a, cos_a;
+    sincosq(a, &sin_a, &cos_a);
+    return sin_a;
+}
+
+ddouble cosq(ddouble a)
+{
+    ddouble sin_a, cos_a;
+    sincosq(a, &sin_a, &cos_a);
+    return cos_a;
 }
 
 ddouble sinhq(ddouble a)
 {
+    if (isnanq(a))
+        return nanq();
     if (iszeroq(a))
         return Q_ZERO;
 
@@ -472,9 +876,16 @@ ddouble coshq(ddouble a)
 
 ddouble tanhq(ddouble a)
 {
+    if (isnanq(a))
+        return nanq();
     if (iszeroq(a))
         return Q_ZERO;
 
+    /* 1 - |tanh(a)| = 2 exp(-2|a|) + ... is below eps, which also keeps
+     * exp(a) from overflowing
+     */
+    if (fabs(a.hi) > 40.0)
+        return (ddouble){copysign(1.0, a.hi), 0.0};
     if (fabs(a.hi) > 0.05) {
         ddouble ea = expq(a);
         ddouble inv_ea = reciprocalq(ea);
@@ -12,6 +12,26 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
+#include "dd_dispatch.h"
+
+/* Functions defined in dd_arith.c, which is compiled for several
+ * instruction sets (see dd_dispatch.h).
+ */
+#define sqrtq DD_ISA_NAME(sqrtq)
+#define _hypotqq_ordered DD_ISA_NAME(_hypotqq_ordered)
+#define expq DD_ISA_NAME(expq)
+#define expm1q DD_ISA_NAME(expm1q)
+#define logq DD_ISA_NAME(logq)
+#define log2q DD_ISA_NAME(log2q)
+#define log10q DD_ISA_NAME(log10q)
+#define log1pq DD_ISA_NAME(log1pq)
+#define sinq DD_ISA_NAME(sinq)
+#define cosq DD_ISA_NAME(cosq)
+#define sincosq DD_ISA_NAME(sincosq)
+#define sinhq DD_ISA_NAME(sinhq)
+#define coshq DD_ISA_NAME(coshq)
+#define tanhq DD_ISA_NAME(tanhq)
+
 /**
  * Type for double-double calculations
  */
@@ -301,6 +321,8 @@ static const ddouble Q_PI_4 = {7.853981633974482790e-01, 3.061616997868383018e-1
 static const ddouble Q_E = {2.718281828459045091e+00, 1.445646891729250158e-16};
 static const ddouble Q_LOG2 = {6.931471805599452862e-01, 2.319046813846299558e-17};
 static const ddouble Q_LOG10 = {2.302585092994045901e+00, -2.170756223382249351e-16};
+static const ddouble Q_1_LOG2 = {1.442695040888963387e+00, 2.035527374093103311e-17};
+static const ddouble Q_1_LOG10 = {4.342944819032518167e-01, 1.098319650216765073e-17};
 
 static const ddouble Q_EPS = {4.93038065763132e-32, 0.0};
 static const ddouble Q_MIN = {2.0041683600089728e-292, 0.0};
@@ -509,8 +531,12 @@ static inline ddouble hypotqd(ddouble x, double y)
 ddouble expq(ddouble a);
 ddouble expm1q(ddouble a);
 ddouble logq(ddouble a);
+ddouble log2q(ddouble a);
+ddouble log10q(ddouble a);
+ddouble log1pq(ddouble a);
 ddouble sinq(ddouble a);
 ddouble cosq(ddouble a);
+void sincosq(ddouble a, ddouble *sin_a, ddouble *cos_a);
 ddouble sinhq(ddouble a);
 ddouble coshq(ddouble a);
 ddouble tanhq(ddouble a);
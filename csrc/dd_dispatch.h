@@ -0,0 +1,25 @@
+/* Helpers for compiling kernels for several instruction sets.
+ *
+ * Sources containing hot kernels are compiled several times: once for the
+ * baseline architecture and once for each instruction set variant listed in
+ * setup.py, where the macro `DD_ISA` is set to the name of the variant.  To
+ * allow linking all copies into the same extension, external symbols in
+ * those sources must be suffixed with the variant name using `DD_ISA_NAME`.
+ *
+ * Copyright (C) 2021 Markus Wallerberger and others
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#define DD_CONCAT_(a, b) a ## _ ## b
+#define DD_CONCAT(a, b) DD_CONCAT_(a, b)
+#define DD_STRING_(a) #a
+#define DD_STRING(a) DD_STRING_(a)
+
+#ifdef DD_ISA
+#define DD_ISA_NAME(name) DD_CONCAT(name, DD_ISA)
+#define DD_ISA_STRING DD_STRING(DD_ISA)
+#else
+#define DD_ISA_NAME(name) name
+#define DD_ISA_STRING "baseline"
+#endif
@@ -8,47 +8,76 @@
  */
 #include "dd_linalg.h"
 
+#include <float.h>
+#include <stdlib.h>
+
 // 2**500 and 2**(-500);
 static const double LARGE = 3.273390607896142e+150;
 static const double INV_LARGE = 3.054936363499605e-151;
 
-static ddouble normq_scaled(const ddouble *x, long nn, long sxn,
-                            double scaling)
+typedef struct {
+    const ddouble *x;
+    long sxn;
+    double scaling;
+} sumsq_args;
+
+static ddouble sumsq_block(const void *_args, long start, long size)
 {
+    const sumsq_args *args = (const sumsq_args *)_args;
+    const ddouble *x = args->x + start * args->sxn;
     ddouble sum = Q_ZERO;
-    for (long n = 0; n < nn; ++n, x += sxn) {
-        ddouble curr = mul_pwr2(*x, scaling);
+    for (long n = 0; n < size; ++n, x += args->sxn) {
+        ddouble curr = mul_pwr2(*x, args->scaling);
         sum = addqq(sum, sqrq(curr));
     };
+    return sum;
+}
+
+static ddouble normq_scaled(const ddouble *x, long nn, long sxn,
+                            double scaling, const ddparallel *par)
+{
+    sumsq_args args = {x, sxn, scaling};
+    ddouble sum = dd_parallel_reduce(par, sumsq_block, addqq, &args, nn, 2);
     return mul_pwr2(sqrtq(sum), 1.0/scaling);
 }
 
-ddouble normq(const ddouble *x, long nn, long sxn)
+ddouble normq(const ddouble *x, long nn, long sxn, const ddparallel *par)
 {
-    ddouble sum = normq_scaled(x, nn, sxn, 1.0);
+    ddouble sum = normq_scaled(x, nn, sxn, 1.0, par);
 
     // fall back to other routines in case of over/underflow
     if (sum.hi > LARGE)
-        return normq_scaled(x, nn, sxn, INV_LARGE);
+        return normq_scaled(x, nn, sxn, INV_LARGE, par);
     else if (sum.hi < INV_LARGE)
-        return normq_scaled(x, nn, sxn, LARGE);
+        return normq_scaled(x, nn, sxn, LARGE, par);
     else
         return sum;
 }
 
-ddouble householderq(const ddouble *x, ddouble *v, long nn, long sx, long sv)
+/* Same as householderq, but also returns the first element `beta` of the
+ * reflected vector.  `v` may alias `x`.
+ */
+static ddouble householder_beta(const ddouble *x, ddouble *v, long nn,
+                                long sx, long sv, ddouble *beta_out)
 {
     if (nn == 0)
         return Q_ZERO;
 
-    ddouble norm_x = normq(x + sx, nn - 1, sx);
-    if (iszeroq(norm_x))
+    ddouble alpha = *x;
+    ddouble norm_x = normq(x + sx, nn - 1, sx, &DD_SERIAL);
+    *beta_out = alpha;
+    if (iszeroq(norm_x)) {
+        v[0] = Q_ONE;
+        for (long n = 1; n != nn; ++n)
+            v[n * sv] = Q_ZERO;
         return Q_ZERO;
+    }
 
-    ddouble alpha = *x;
     ddouble beta = copysignqq(hypotqq(alpha, norm_x), alpha);
+    *beta_out = beta;
 
-    ddouble diff = subqq(beta, alpha);
+    /* beta - alpha, computed without cancellation */
+    ddouble diff = divqq(sqrq(norm_x), addqq(beta, alpha));
     ddouble tau = divqq(diff, beta);
     ddouble scale = reciprocalq(negq(diff));
 
@@ -58,14 +87,463 @@ ddouble householderq(const ddouble *x, ddouble *v, long nn, long sx, long sv)
     return tau;
 }
 
-void rank1updateq(ddouble *a, long ais, long ajs, const ddouble *v, long vs,
-                  const ddouble *w, long ws, long ii, long jj)
+ddouble householderq(const ddouble *x, ddouble *v, long nn, long sx, long sv)
+{
+    ddouble beta;
+    return householder_beta(x, v, nn, sx, sv, &beta);
+}
+
+/* Number of reflectors applied at once by householder_qrq */
+#define QR_BLOCK 64
+
+/* Number of columns of the trailing matrix updated at once */
+#define QR_CHUNK 256
+
+/* Minimum number of multiply-adds to split an update across threads */
+#define QR_PARALLEL 32768
+
+/* Number of columns factored at once by lu_factorq */
+#define LU_BLOCK 64
+
+/* Apply the reflector I - tau v v.T to the `ii` times `jj` matrix B.
+ *
+ * Given a buffer `w` for `jj` elements, v[0] must be stored as one, and the
+ * reflector is applied as a matrix-vector product followed by a rank-one
+ * update.  Otherwise, v[0] = 1 is implicit, and B is updated column by
+ * column.
+ */
+static void reflector_apply(const ddouble *v, long sv, ddouble tau,
+                            ddouble *b, long sbi, long sbj, long ii, long jj,
+                            ddouble *w, const ddkernels *kern)
+{
+    if (iszeroq(tau) || jj == 0)
+        return;
+
+    if (w != NULL) {
+        /* w = -tau B.T v, then B += v w.T */
+        kern->matmul(v, 0, sv, b, sbi, sbj, w, 0, 1, 1, ii, jj);
+        for (long c = 0; c < jj; ++c)
+            w[c] = negq(mulqq(tau, w[c]));
+        kern->rank1update(b, sbi, sbj, v, sv, w, 1, ii, jj);
+        return;
+    }
+
+    #pragma omp parallel for if(jj * ii >= QR_PARALLEL)
+    for (long c = 0; c < jj; ++c) {
+        ddouble *y = b + c * sbj;
+        ddouble vy = addqq(y[0], kern->dot(v + sv, sv, y + sbi, sbi, ii - 1));
+        ddouble w = negq(mulqq(tau, vy));
+        y[0] = addqq(y[0], w);
+        for (long n = 1; n < ii; ++n)
+            y[n * sbi] = addqq(y[n * sbi], mulqq(v[n * sv], w));
+    }
+}
+
+/* Unblocked QR of the `ii` times `jj` panel of A, where the first `kk`
+ * columns are reduced.  The reflectors are applied to the remaining columns
+ * one by one.
+ */
+static void qr_panel(ddouble *a, long sai, long saj, ddouble *tau, long stau,
+                     long ii, long jj, long kk, ddouble *w,
+                     const ddkernels *kern)
+{
+    for (long j = 0; j < kk; ++j) {
+        ddouble *x = a + j * sai + j * saj, beta;
+        long nn = ii - j;
+        ddouble tau_j = householder_beta(x, x, nn, sai, sai, &beta);
+        tau[j * stau] = tau_j;
+        reflector_apply(x, sai, tau_j, x + saj, sai, saj, nn, jj - j - 1, w,
+                        kern);
+        x[0] = beta;
+    }
+}
+
+/* Buffers for applying up to QR_BLOCK reflectors at once to `ii` rows */
+typedef struct {
+    ddouble *v, *t, *w, *tw, *y;
+} wy_work;
+
+static bool wy_alloc(wy_work *work, long ii)
 {
-    #pragma omp parallel for collapse(2)
+    work->v = malloc(ii * QR_BLOCK * sizeof(ddouble));
+    work->t = malloc(QR_BLOCK * QR_BLOCK * sizeof(ddouble));
+    work->w = malloc(2 * QR_BLOCK * QR_CHUNK * sizeof(ddouble));
+    work->tw = work->w + QR_BLOCK * QR_CHUNK;
+    work->y = malloc(ii * QR_CHUNK * sizeof(ddouble));
+    return work->v != NULL && work->t != NULL && work->w != NULL
+           && work->y != NULL;
+}
+
+static void wy_free(wy_work *work)
+{
+    free(work->v);
+    free(work->t);
+    free(work->w);
+    free(work->y);
+}
+
+/* Copy the `ii` times `kk` reflectors below the diagonal of A to V, stored
+ * by rows with QR_BLOCK elements each, and build the upper triangular T
+ * such that H[0] ... H[kk - 1] = I - V T V.T (LAPACK's dlarft).
+ */
+static void wy_build(const ddouble *a, long sai, long saj, const ddouble *tau,
+                     long stau, long ii, long kk, wy_work *work,
+                     const ddkernels *kern)
+{
+    ddouble *v = work->v, *t = work->t;
+    const long ldv = QR_BLOCK, ldt = QR_BLOCK;
+
     for (long i = 0; i < ii; ++i) {
-        for (long j = 0; j < jj; ++j) {
-            ddouble tmp = mulqq(v[i * vs], w[j * ws]);
-            a[i * ais + j * ajs] = addqq(a[i * ais + j * ajs], tmp);
+        for (long j = 0; j < kk; ++j) {
+            ddouble *vij = &v[i * ldv + j];
+            if (i < j)
+                *vij = Q_ZERO;
+            else if (i == j)
+                *vij = Q_ONE;
+            else
+                *vij = a[i * sai + j * saj];
+        }
+    }
+    for (long j = 0; j < kk; ++j) {
+        ddouble tau_j = tau[j * stau];
+        const ddouble *v_j = v + j * ldv + j;
+        for (long i = 0; i < j; ++i) {
+            ddouble z = kern->dot(v + j * ldv + i, ldv, v_j, ldv, ii - j);
+            t[i * ldt + j] = negq(mulqq(tau_j, z));
+        }
+        /* T[:j, j] = T[:j, :j] @ T[:j, j] using the upper triangle */
+        for (long i = 0; i < j; ++i) {
+            ddouble sum = Q_ZERO;
+            for (long l = i; l < j; ++l)
+                sum = addqq(sum, mulqq(t[i * ldt + l], t[l * ldt + j]));
+            t[i * ldt + j] = sum;
+        }
+        t[j * ldt + j] = tau_j;
+        for (long i = j + 1; i < kk; ++i)
+            t[i * ldt + j] = Q_ZERO;
+    }
+}
+
+/* Apply I - V T V.T as built by wy_build, or its transpose if `trans` is
+ * set, to the `ii` times `jj` matrix B using three matrix products.
+ */
+static void wy_apply(const wy_work *work, long ii, long kk, bool trans,
+                     ddouble *b, long sbi, long sbj, long jj,
+                     const ddkernels *kern)
+{
+    const long ldv = QR_BLOCK, ldt = QR_BLOCK;
+    const long sti = trans ? 1 : ldt, stj = trans ? ldt : 1;
+    ddouble *w = work->w, *tw = work->tw, *y = work->y;
+
+    for (long c0 = 0; c0 < jj; c0 += QR_CHUNK) {
+        long nc = jj - c0 < QR_CHUNK ? jj - c0 : QR_CHUNK;
+        ddouble *b0 = b + c0 * sbj;
+        kern->matmul(work->v, 1, ldv, b0, sbi, sbj, w, nc, 1, kk, ii, nc);
+        kern->matmul(work->t, sti, stj, w, nc, 1, tw, nc, 1, kk, kk, nc);
+        kern->matmul(work->v, ldv, 1, tw, nc, 1, y, nc, 1, ii, kk, nc);
+
+        #pragma omp parallel for if(ii * nc * kk >= QR_PARALLEL)
+        for (long i = 0; i < ii; ++i) {
+            for (long c = 0; c < nc; ++c) {
+                ddouble *bic = &b0[i * sbi + c * sbj];
+                *bic = subqq(*bic, y[i * nc + c]);
+            }
+        }
+    }
+}
+
+bool householder_qrq(ddouble *a, long sai, long saj, ddouble *tau, long stau,
+                     long ii, long jj, const ddkernels *kern)
+{
+    long kk = ii < jj ? ii : jj;
+    for (long j = kk; j < jj; ++j)
+        tau[j * stau] = Q_ZERO;
+
+    wy_work work;
+    bool blocked = wy_alloc(&work, ii);
+    if (!blocked) {
+        qr_panel(a, sai, saj, tau, stau, ii, jj, kk, NULL, kern);
+        goto cleanup;
+    }
+
+    for (long j0 = 0; j0 < kk; j0 += QR_BLOCK) {
+        long nb = kk - j0 < QR_BLOCK ? kk - j0 : QR_BLOCK;
+        long mr = ii - j0;
+        ddouble *a0 = a + j0 * sai + j0 * saj;
+        qr_panel(a0, sai, saj, tau + j0 * stau, stau, mr, nb, nb, work.w,
+                 kern);
+        if (j0 + nb == jj)
+            break;
+
+        /* Update trailing matrix: A2 -= V T.T V.T A2 */
+        wy_build(a0, sai, saj, tau + j0 * stau, stau, mr, nb, &work, kern);
+        wy_apply(&work, mr, nb, true, a0 + nb * saj, sai, saj,
+                 jj - j0 - nb, kern);
+    }
+
+cleanup:
+    wy_free(&work);
+    return blocked;
+}
+
+bool householder_applyq(const ddouble *h, long shi, long shk, long ii,
+                        long kk, ddouble *b, long sbi, long sbj, long jj,
+                        bool trans, bool unit, const ddkernels *kern)
+{
+    if (kk > ii)
+        kk = ii;
+    if (unit) {
+        for (long i = 0; i < ii; ++i) {
+            for (long j = 0; j < jj; ++j)
+                b[i * sbi + j * sbj] = i == j ? Q_ONE : Q_ZERO;
+        }
+    }
+
+    /* Q = H[0] ... H[kk - 1] is applied starting from the last reflector,
+     * its transpose starting from the first.  When forming Q, the columns
+     * before the current reflector are still those of the identity, which
+     * the remaining reflectors do not touch.
+     */
+    long sh = shi + shk;
+    wy_work work;
+    bool blocked = wy_alloc(&work, ii);
+    if (!blocked) {
+        for (long n = 0; n < kk; ++n) {
+            long j = trans ? n : kk - 1 - n;
+            long c0 = unit && !trans ? (j < jj ? j : jj) : 0;
+            reflector_apply(h + j * sh, shi, h[j * sh],
+                            b + j * sbi + c0 * sbj, sbi, sbj, ii - j,
+                            jj - c0, NULL, kern);
+        }
+        goto cleanup;
+    }
+
+    long nblocks = (kk + QR_BLOCK - 1) / QR_BLOCK;
+    for (long n = 0; n < nblocks; ++n) {
+        long j0 = (trans ? n : nblocks - 1 - n) * QR_BLOCK;
+        long nb = kk - j0 < QR_BLOCK ? kk - j0 : QR_BLOCK;
+        long c0 = unit && !trans ? (j0 < jj ? j0 : jj) : 0;
+        if (c0 == jj)
+            continue;
+        wy_build(h + j0 * sh, shi, shk, h + j0 * sh, sh, ii - j0, nb, &work,
+                 kern);
+        wy_apply(&work, ii - j0, nb, trans, b + j0 * sbi + c0 * sbj, sbi,
+                 sbj, jj - c0, kern);
+    }
+
+cleanup:
+    wy_free(&work);
+    return blocked;
+}
+
+/* The norm of a column is recomputed rather than downdated once it has
+ * decreased by this factor since it was last computed (LAPACK's dlaqp2).
+ */
+#define RRQR_RECOMPUTE DBL_EPSILON
+
+long householder_rrqrq(ddouble *a, long sai, long saj, ddouble *tau, long stau,
+                       long *jpvt, long ii, long jj, ddouble tol,
+                       const ddkernels *kern)
+{
+    long kk = ii < jj ? ii : jj;
+    ddouble *norms = malloc(3 * jj * sizeof(ddouble));
+    if (norms == NULL)
+        return -1;
+    ddouble *xnorms = norms + jj, *w = norms + 2 * jj;
+
+    #pragma omp parallel for if(ii * jj >= QR_PARALLEL)
+    for (long j = 0; j < jj; ++j) {
+        norms[j] = normq(a + j * saj, ii, sai, &DD_SERIAL);
+        xnorms[j] = norms[j];
+        jpvt[j] = j;
+    }
+
+    long rank = kk;
+    for (long i = 0; i < kk; ++i) {
+        long pvt = i;
+        for (long j = i + 1; j < jj; ++j) {
+            if (greaterqq(norms[j], norms[pvt]))
+                pvt = j;
+        }
+        if (pvt != i) {
+            for (long n = 0; n < ii; ++n) {
+                ddouble tmp = a[n * sai + i * saj];
+                a[n * sai + i * saj] = a[n * sai + pvt * saj];
+                a[n * sai + pvt * saj] = tmp;
+            }
+            long tmp = jpvt[i];
+            jpvt[i] = jpvt[pvt];
+            jpvt[pvt] = tmp;
+            norms[pvt] = norms[i];
+            xnorms[pvt] = xnorms[i];
+        }
+
+        ddouble *x = a + i * sai + i * saj, beta;
+        ddouble tau_i = householder_beta(x, x, ii - i, sai, sai, &beta);
+        tau[i * stau] = tau_i;
+        reflector_apply(x, sai, tau_i, x + saj, sai, saj, ii - i, jj - i - 1,
+                        w, kern);
+        x[0] = beta;
+
+        /* Downdate the norms of the remaining columns */
+        #pragma omp parallel for if((jj - i) * (ii - i) >= QR_PARALLEL)
+        for (long j = i + 1; j < jj; ++j) {
+            if (iszeroq(norms[j]))
+                continue;
+            ddouble temp = divqq(absq(a[i * sai + j * saj]), norms[j]);
+            temp = mulqq(addqd(temp, 1.0), subdq(1.0, temp));
+            temp = fmaxqd(temp, 0.0);
+            ddouble ratio = divqq(norms[j], xnorms[j]);
+            if (lessqd(mulqq(temp, sqrq(ratio)), RRQR_RECOMPUTE)) {
+                norms[j] = normq(a + (i + 1) * sai + j * saj, ii - i - 1,
+                                 sai, &DD_SERIAL);
+                xnorms[j] = norms[j];
+            } else {
+                norms[j] = mulqq(norms[j], sqrtq(temp));
+            }
+        }
+
+        /* For a zero matrix, the ratio is undefined: do not stop early */
+        if (!iszeroq(a[0])
+                && lessqq(absq(divqq(a[i * sai + i * saj], a[0])), tol)) {
+            rank = i + 1;
+            break;
+        }
+    }
+    for (long j = rank; j < jj; ++j)
+        tau[j * stau] = Q_ZERO;
+
+    free(norms);
+    return rank;
+}
+
+/* Swap rows i and p of the `jj` columns of A */
+static void swap_rows(ddouble *a, long sai, long saj, long i, long p, long jj)
+{
+    for (long j = 0; j < jj; ++j) {
+        ddouble tmp = a[i * sai + j * saj];
+        a[i * sai + j * saj] = a[p * sai + j * saj];
+        a[p * sai + j * saj] = tmp;
+    }
+}
+
+/* Unblocked LU with partial pivoting of the `ii` times `jj` panel of A,
+ * where `ii >= jj` (LAPACK's dgetf2).  Row swaps are applied to the panel
+ * only, and `piv` is relative to the panel.  `w` is a buffer for `jj`
+ * elements.  Returns zero or the first zero pivot, counted from one.
+ */
+static long lu_panel(ddouble *a, long sai, long saj, long *piv, long ii,
+                     long jj, ddouble *w, const ddkernels *kern)
+{
+    long info = 0;
+    for (long j = 0; j < jj; ++j) {
+        ddouble *x = a + j * sai + j * saj;
+        long pvt = 0;
+        for (long i = 1; i < ii - j; ++i) {
+            if (greaterqq(absq(x[i * sai]), absq(x[pvt * sai])))
+                pvt = i;
+        }
+        piv[j] = j + pvt;
+        if (iszeroq(x[pvt * sai])) {
+            if (info == 0)
+                info = j + 1;
+            continue;
+        }
+        if (pvt != 0)
+            swap_rows(a, sai, saj, j, j + pvt, jj);
+
+        for (long i = 1; i < ii - j; ++i)
+            x[i * sai] = divqq(x[i * sai], x[0]);
+        for (long c = 1; c < jj - j; ++c)
+            w[c - 1] = negq(x[c * saj]);
+        kern->rank1update(x + sai + saj, sai, saj, x + sai, sai, w, 1,
+                          ii - j - 1, jj - j - 1);
+    }
+    return info;
+}
+
+long lu_factorq(ddouble *a, long sai, long saj, long *piv, long nn,
+                const ddkernels *kern)
+{
+    long info = 0;
+    ddouble *w = malloc(LU_BLOCK * sizeof(ddouble));
+    ddouble *y = malloc(nn * QR_CHUNK * sizeof(ddouble));
+    if (w == NULL || y == NULL) {
+        info = -1;
+        goto cleanup;
+    }
+
+    for (long j0 = 0; j0 < nn; j0 += LU_BLOCK) {
+        long nb = nn - j0 < LU_BLOCK ? nn - j0 : LU_BLOCK;
+        long mr = nn - j0, nr = nn - j0 - nb;
+        ddouble *a0 = a + j0 * sai + j0 * saj, *a12 = a0 + nb * saj;
+        long pinfo = lu_panel(a0, sai, saj, piv + j0, mr, nb, w, kern);
+        if (info == 0 && pinfo != 0)
+            info = j0 + pinfo;
+
+        /* Apply the row swaps to the columns left and right of the panel */
+        for (long j = j0; j < j0 + nb; ++j) {
+            piv[j] += j0;
+            if (piv[j] != j) {
+                swap_rows(a, sai, saj, j, piv[j], j0);
+                swap_rows(a12 - j0 * sai, sai, saj, j, piv[j], nr);
+            }
+        }
+
+        /* A12 = L11^-1 A12, then A22 -= L21 A12 */
+        #pragma omp parallel for if(nb * nb * nr >= QR_PARALLEL)
+        for (long c = 0; c < nr; ++c) {
+            ddouble *x = a12 + c * saj;
+            for (long i = 1; i < nb; ++i) {
+                x[i * sai] = subqq(x[i * sai],
+                                   kern->dot(a0 + i * sai, saj, x, sai, i));
+            }
+        }
+        for (long c0 = 0; c0 < nr; c0 += QR_CHUNK) {
+            long nc = nr - c0 < QR_CHUNK ? nr - c0 : QR_CHUNK;
+            ddouble *b0 = a12 + nb * sai + c0 * saj;
+            kern->matmul(a0 + nb * sai, sai, saj, a12 + c0 * saj, sai, saj,
+                         y, nc, 1, nr, nb, nc);
+
+            #pragma omp parallel for if(nr * nc * nb >= QR_PARALLEL)
+            for (long i = 0; i < nr; ++i) {
+                for (long c = 0; c < nc; ++c) {
+                    ddouble *bic = &b0[i * sai + c * saj];
+                    *bic = subqq(*bic, y[i * nc + c]);
+                }
+            }
+        }
+    }
+
+cleanup:
+    free(w);
+    free(y);
+    return info;
+}
+
+void lu_solveq(const ddouble *a, long sai, long saj, const long *piv,
+               long nn, ddouble *b, long sbi, long sbj, long kk,
+               const ddkernels *kern)
+{
+    #pragma omp parallel for if(nn * nn * kk >= QR_PARALLEL)
+    for (long c = 0; c < kk; ++c) {
+        ddouble *x = b + c * sbj;
+        for (long i = 0; i < nn; ++i) {
+            if (piv[i] != i) {
+                ddouble tmp = x[i * sbi];
+                x[i * sbi] = x[piv[i] * sbi];
+                x[piv[i] * sbi] = tmp;
+            }
+        }
+        for (long i = 1; i < nn; ++i) {
+            x[i * sbi] = subqq(x[i * sbi],
+                               kern->dot(a + i * sai, saj, x, sbi, i));
+        }
+        for (long i = nn - 1; i >= 0; --i) {
+            const ddouble *a_i = a + i * sai + (i + 1) * saj;
+            ddouble r = kern->dot(a_i, saj, x + (i + 1) * sbi, sbi,
+                                  nn - i - 1);
+            x[i * sbi] = divqq(subqq(x[i * sbi], r), a[i * sai + i * saj]);
         }
     }
 }
@@ -188,49 +666,224 @@ void svd_2x2(ddouble a11, ddouble a12, ddouble a21, ddouble a22, ddouble *smin,
         lmul_givensq(cu, su, cx, negq(sx), *cu, *su);
 }
 
-ddouble jacobi_sweep(ddouble *u, long sui, long suj, ddouble *vt, long svi,
-                     long svj, long ii, long jj)
+/* Number of sweeps over the Gram matrix of two column blocks.  These are
+ * not iterated to convergence: the next sweep over the blocks does that.
+ */
+#define JACOBI_INNER 2
+
+/* Returns true if the overlap hij of two columns with squared norms hii and
+ * hjj is below the rounding expected in computing it from `ii` rows, i.e.,
+ * sqrt(ii) eps (LAPACK's dgesvj uses this criterion when the singular
+ * vectors are computed), so rotating it away is pointless.
+ */
+static bool jacobi_small(ddouble hii, ddouble hij, ddouble hjj, long ii)
+{
+    ddouble bound = mulqq(mulqd(Q_EPS, sqrt((double) ii)),
+                          sqrtq(mulqq(hii, hjj)));
+    return lessequalqq(absq(hij), bound);
+}
+
+/* Rotate columns i and j of U and rows i and j of VT such that the two
+ * columns of U become orthogonal, where the larger of the two ends up in
+ * column i.  `norms` holds the squared norms of the columns, which are
+ * updated from the rotation instead of recomputed.  The rotation is skipped
+ * if the columns are already orthogonal and in order.  Returns the square of
+ * their overlap before the rotation, or zero if it was negligible.
+ */
+static ddouble jacobi_rotate(ddouble *u, long sui, long suj, ddouble *vt,
+                             long svi, long svj, long ii, long jj, long i,
+                             long j, ddouble *norms, const ddkernels *kern)
+{
+    ddouble _cu, _su, cv, sv, smin, smax;
+    ddouble *u_i = u + i * suj, *u_j = u + j * suj;
+
+    // Construct the matrix to be diagonalized
+    ddouble Hii = norms[i], Hjj = norms[j];
+    ddouble Hij = kern->dot(u_i, sui, u_j, sui, ii);
+    bool small = jacobi_small(Hii, Hij, Hjj, ii);
+    if (small && !lessqq(Hii, Hjj))
+        return Q_ZERO;
+
+    // diagonalize
+    svd_2x2(Hii, Hij, Hij, Hjj, &smin, &smax, &cv, &sv, &_cu, &_su);
+
+    // apply rotation to VT and transposed rotation to U
+    kern->rot(vt + i * svi, svj, vt + j * svi, svj, cv, sv, jj);
+    kern->rot(u_i, sui, u_j, sui, cv, sv, ii);
+    norms[i] = absq(smax);
+    norms[j] = absq(smin);
+    return small ? Q_ZERO : sqrq(Hij);
+}
+
+/* Orthogonalize the union of the column blocks i0:i0+ni and j0:j0+nj of U
+ * (where nj may be zero), applying the same transformation to the rows of
+ * VT.  The columns are copied to a buffer W, and W.T W is brought closer to
+ * diagonal form by sweeps of two-sided Jacobi rotations, which only touch
+ * the small Gram matrix and the accumulated rotation V.  U and VT are then
+ * updated with a matrix product by V.
+ *
+ * Returns the sum of squares of the non-negligible overlaps between the two
+ * blocks, plus those within the first (second) block if `intra_i`
+ * (`intra_j`) is set.
+ */
+static ddouble jacobi_block(ddouble *u, long sui, long suj, ddouble *vt,
+                            long svi, long svj, long ii, long jj, long i0,
+                            long ni, long j0, long nj, bool intra_i,
+                            bool intra_j, const ddkernels *kern)
 {
-    ddouble _cu, _su, cv, sv, _smin, _smax;
+    long ss = ni + nj;
     ddouble offd = Q_ZERO;
+    if (ss < 2)
+        return offd;
 
-    if (ii < jj)
+    ddouble *w = malloc((ii * ss + 2 * ss * ss + ss * jj) * sizeof(ddouble));
+    if (w == NULL)
         return nanq();
 
-    // Note that the inner loop only runs over the square portion!
-    for (long i = 0; i < jj - 1; ++i) {
-        for (long j = i + 1; j < jj; ++j) {
-            // Construct the matrix to be diagonalized
-            ddouble Hii = Q_ZERO, Hij = Q_ZERO, Hjj = Q_ZERO;
-            for (long k = 0; k != ii; ++k) {
-                ddouble u_ki = u[k * sui + i * suj];
-                ddouble u_kj = u[k * sui + j * suj];
-                Hii = addqq(Hii, mulqq(u_ki, u_ki));
-                Hij = addqq(Hij, mulqq(u_ki, u_kj));
-                Hjj = addqq(Hjj, mulqq(u_kj, u_kj));
+    ddouble *g = w + ii * ss, *v = g + ss * ss, *x = v + ss * ss;
+    for (long q = 0; q < ss; ++q) {
+        const ddouble *u_q = u + (q < ni ? i0 + q : j0 + q - ni) * suj;
+        for (long k = 0; k < ii; ++k)
+            w[q * ii + k] = u_q[k * sui];
+    }
+    kern->matmul(w, ii, 1, w, 1, ii, g, ss, 1, ss, ii, ss);
+
+    bool rotate = false;
+    for (long p = 0; p < ss; ++p) {
+        for (long q = p + 1; q < ss; ++q) {
+            ddouble gpq = g[p * ss + q];
+            if (jacobi_small(g[p * ss + p], gpq, g[q * ss + q], ii)) {
+                if (lessqq(g[p * ss + p], g[q * ss + q]))
+                    rotate = true;
+                continue;
             }
-            offd = addqq(offd, sqrq(Hij));
+            rotate = true;
+            if (q < ni ? intra_i : p >= ni ? intra_j : true)
+                offd = addqq(offd, sqrq(gpq));
+        }
+    }
+    if (!rotate)
+        goto cleanup;
 
-            // diagonalize
-            svd_2x2(Hii, Hij, Hij, Hjj, &_smin, &_smax, &cv, &sv, &_cu, &_su);
+    for (long p = 0; p < ss; ++p) {
+        for (long q = 0; q < ss; ++q)
+            v[p * ss + q] = p == q ? Q_ONE : Q_ZERO;
+    }
+    for (long sweep = 0; rotate && sweep < JACOBI_INNER; ++sweep) {
+        rotate = false;
+        for (long p = 0; p < ss - 1; ++p) {
+            for (long q = p + 1; q < ss; ++q) {
+                ddouble _cu, _su, cv, sv, smin, smax;
+                ddouble gpp = g[p * ss + p], gpq = g[p * ss + q],
+                        gqq = g[q * ss + q];
+                if (jacobi_small(gpp, gpq, gqq, ii) && !lessqq(gpp, gqq))
+                    continue;
 
-            // apply rotation to VT
-            for (long k = 0; k < jj; ++k) {
-                ddouble *vt_ik = &vt[i * svi + k * svj];
-                ddouble *vt_jk = &vt[j * svi + k * svj];
-                lmul_givensq(vt_ik, vt_jk, cv, sv, *vt_ik, *vt_jk);
+                rotate = true;
+                svd_2x2(gpp, gpq, gpq, gqq, &smin, &smax, &cv, &sv, &_cu,
+                        &_su);
+                kern->rot(g + p * ss, 1, g + q * ss, 1, cv, sv, ss);
+                kern->rot(g + p, ss, g + q, ss, cv, sv, ss);
+                kern->rot(v + p, ss, v + q, ss, cv, sv, ss);
+                g[p * ss + p] = absq(smax);
+                g[q * ss + q] = absq(smin);
+                g[p * ss + q] = g[q * ss + p] = Q_ZERO;
             }
+        }
+    }
 
-            // apply transposed rotation to U
-            for (long k = 0; k < ii; ++k) {
-                ddouble *u_ki = &u[k * sui + i * suj];
-                ddouble *u_kj = &u[k * sui + j * suj];
-                lmul_givensq(u_ki, u_kj, cv, sv, *u_ki, *u_kj);
+    // U[:, block] = W @ V[:, block]
+    kern->matmul(w, 1, ii, v, ss, 1, u + i0 * suj, sui, suj, ii, ss, ni);
+    if (nj > 0)
+        kern->matmul(w, 1, ii, v + ni, ss, 1, u + j0 * suj, sui, suj, ii, ss,
+                     nj);
+
+    // VT[block, :] = V[:, block].T @ VT[blocks, :]
+    for (long q = 0; q < ss; ++q) {
+        const ddouble *vt_q = vt + (q < ni ? i0 + q : j0 + q - ni) * svi;
+        for (long k = 0; k < jj; ++k)
+            x[q * jj + k] = vt_q[k * svj];
+    }
+    kern->matmul(v, 1, ss, x, jj, 1, vt + i0 * svi, svi, svj, ni, ss, jj);
+    if (nj > 0)
+        kern->matmul(v + ni, 1, ss, x, jj, 1, vt + j0 * svi, svi, svj, nj,
+                     ss, jj);
+
+cleanup:
+    free(w);
+    return offd;
+}
+
+ddouble jacobi_sweep(ddouble *u, long sui, long suj, ddouble *vt, long svi,
+                     long svj, long ii, long jj, long block,
+                     const ddkernels *kern)
+{
+    ddouble offd = Q_ZERO;
+
+    if (ii < jj)
+        return nanq();
+    if (block < 1)
+        block = 1;
+
+    /* With column blocks of size `block`, the cyclic ordering processes the
+     * pairs of blocks (0, 1), (0, 2), ..., (0, nblocks-1), (1, 2), and so
+     * on.  The pairs touching a given block then have i + j increasing, and
+     * all pairs with the same i + j are disjoint.  We thus process the
+     * anti-diagonals i + j = 1, ..., 2 nblocks - 3 one by one and work on
+     * the pairs on each anti-diagonal in parallel.  This does the same
+     * operations in the same order on each column as the cyclic ordering,
+     * so the result does not depend on the number of threads and the
+     * convergence is that of the cyclic sweep.  (Round-robin orderings need
+     * only nblocks - 1 steps, but converge much slower for graded matrices
+     * because they do not keep the columns sorted.)
+     */
+    long nblocks = (jj + block - 1) / block;
+    ddouble *norms = malloc(jj * sizeof(ddouble));
+    ddouble *offd_pair = malloc((nblocks / 2 + 1) * sizeof(ddouble));
+    if (norms == NULL || offd_pair == NULL) {
+        offd = nanq();
+        goto cleanup;
+    }
+
+    if (block == 1) {
+        #pragma omp parallel for if(ii * jj >= QR_PARALLEL)
+        for (long j = 0; j < jj; ++j)
+            norms[j] = kern->dot(u + j * suj, sui, u + j * suj, sui, ii);
+    } else if (nblocks == 1) {
+        offd = jacobi_block(u, sui, suj, vt, svi, svj, ii, jj, 0, jj, jj, 0,
+                            true, false, kern);
+    }
+
+    for (long diag = 1; diag <= 2 * nblocks - 3; ++diag) {
+        long ifirst = diag - (nblocks - 1) > 0 ? diag - (nblocks - 1) : 0;
+        long npairs = (diag + 1) / 2 - ifirst;
+
+        #pragma omp parallel for if(ii * jj >= QR_PARALLEL)
+        for (long k = 0; k < npairs; ++k) {
+            long i = ifirst + k, j = diag - i;
+            if (block == 1) {
+                offd_pair[k] = jacobi_rotate(u, sui, suj, vt, svi, svj, ii,
+                                             jj, i, j, norms, kern);
+            } else {
+                /* The overlaps within a block are counted once per sweep,
+                 * when it meets the next one (the last block: the one
+                 * before it).
+                 */
+                long nj = j == nblocks - 1 ? jj - j * block : block;
+                offd_pair[k] = jacobi_block(
+                            u, sui, suj, vt, svi, svj, ii, jj, i * block,
+                            block, j * block, nj, j == i + 1,
+                            j == i + 1 && j == nblocks - 1, kern);
             }
         }
+        for (long k = 0; k < npairs; ++k)
+            offd = addqq(offd, offd_pair[k]);
     }
-    offd = sqrtq(offd);
-    return offd;
+
+cleanup:
+    free(norms);
+    free(offd_pair);
+    return sqrtq(offd);
 }
 
 static ddouble gk_shift(ddouble d1, ddouble e1, ddouble d2)
@@ -283,3 +936,488 @@ void golub_kahan_chaseq(ddouble *d, long sd, ddouble *e, long se, long ii,
     }
     e[(ii-2)*se] = f;
 }
+
+/* Number of columns a sequence of rotations is applied to at once */
+#define ROT_TILE 64
+
+/* Apply the rotations (rot[n * srot], rot[n * srot + 1]) to the lines
+ * a[n, :] and a[n + 1, :], n = 0, ..., nn - 2, of a matrix with `jj`
+ * columns, each tile of columns passing through the whole sequence.
+ */
+static void rot_seq(const ddouble *rot, long srot, ddouble *a, long sai,
+                    long saj, long nn, long jj, const ddkernels *kern)
+{
+    #pragma omp parallel for if(nn * jj >= QR_PARALLEL)
+    for (long j0 = 0; j0 < jj; j0 += ROT_TILE) {
+        long j1 = jj - j0 < ROT_TILE ? jj : j0 + ROT_TILE;
+        for (long n = 0; n < nn - 1; ++n) {
+            ddouble *x = a + n * sai + j0 * saj;
+            kern->rot(x, saj, x + sai, saj, rot[n * srot], rot[n * srot + 1],
+                      j1 - j0);
+        }
+    }
+}
+
+/* Off-diagonal elements of the bidiagonal matrix below this size relative
+ * to the diagonal are set to zero.
+ */
+#define SVD_DEFLATE 5e-32
+
+long svd_bidiagq(ddouble *d, long sd, ddouble *e, long se, long kk,
+                 ddouble *u, long sui, long suj, long ii,
+                 ddouble *vt, long svi, long svj, long jj, long max_iter,
+                 ddouble *rot, const ddkernels *kern)
+{
+    for (long iter = 0; ; ++iter) {
+        for (long i = 0; i < kk - 1; ++i) {
+            ddouble abs_e = absq(e[i * se]);
+            ddouble limit = mulqd(addqq(absq(d[i * sd]), abs_e), SVD_DEFLATE);
+            if (lessequalqq(abs_e, limit))
+                e[i * se] = Q_ZERO;
+        }
+
+        /* Chase the last block d[p:q+2] with nonzero off-diagonal */
+        long q = kk - 2;
+        while (q >= 0 && iszeroq(e[q * se]))
+            --q;
+        if (q < 0)
+            return 0;
+        if (iter == max_iter) {
+            long info = 0;
+            for (long i = 0; i <= q; ++i)
+                info += !iszeroq(e[i * se]);
+            return info;
+        }
+
+        long p = q;
+        while (p > 0 && !iszeroq(e[(p - 1) * se]))
+            --p;
+        long nn = q + 2 - p;
+        golub_kahan_chaseq(d + p * sd, sd, e + p * se, se, nn, rot);
+        rot_seq(rot + 2, 4, u + p * suj, suj, sui, nn, ii, kern);
+        rot_seq(rot, 4, vt + p * svi, svi, svj, nn, jj, kern);
+    }
+}
+
+/* ------------------ Divide and conquer bidiagonal SVD ------------------ */
+
+/* Subproblems up to this size are solved by implicit QR (LAPACK's smlsiz) */
+#define DC_LEAF 25
+
+/* Maximum number of iterations for a root of the secular equation */
+#define DC_MAX_ITER 400
+
+/* SVD of the `n` times `n + sqre` upper bidiagonal leaf.  If `sqre` is set,
+ * the last column is first rotated away from the right.
+ */
+static long dc_leaf(ddouble *d, ddouble *e, long n, long sqre,
+                    ddouble *u, long sui, long suj,
+                    ddouble *vt, long svi, long svj, const ddkernels *kern)
+{
+    long m = n + sqre;
+    for (long i = 0; i < n; ++i) {
+        for (long j = 0; j < n; ++j)
+            u[i * sui + j * suj] = i == j ? Q_ONE : Q_ZERO;
+    }
+    for (long i = 0; i < m; ++i) {
+        for (long j = 0; j < m; ++j)
+            vt[i * svi + j * svj] = i == j ? Q_ONE : Q_ZERO;
+    }
+    if (sqre) {
+        ddouble f = e[n - 1];
+        e[n - 1] = Q_ZERO;
+        for (long j = n - 1; j >= 0 && !iszeroq(f); --j) {
+            ddouble c, s;
+            givensq(d[j], f, &c, &s, &d[j]);
+            kern->rot(vt + j * svi, svj, vt + n * svi, svj, c, s, m);
+            if (j > 0) {
+                f = negq(mulqq(s, e[j - 1]));
+                e[j - 1] = mulqq(c, e[j - 1]);
+            }
+        }
+    }
+
+    ddouble *rot = malloc(4 * n * sizeof(ddouble));
+    if (rot == NULL)
+        return -1;
+    long info = svd_bidiagq(d, 1, e, 1, n, u, sui, suj, n, vt, svi, svj, m,
+                            20 * n, rot, kern);
+    free(rot);
+
+    for (long i = 0; i < n; ++i) {
+        if (signbitq(d[i])) {
+            d[i] = negq(d[i]);
+            for (long j = 0; j < m; ++j)
+                vt[i * svi + j * svj] = negq(vt[i * svi + j * svj]);
+        }
+    }
+    return info;
+}
+
+/* Pole of the merged problem: diagonal element, coupling element, and the
+ * index of the corresponding column of U and row of VT in the block.
+ */
+typedef struct {
+    ddouble d, z;
+    long col;
+} dc_pole;
+
+static int dc_pole_cmp(const void *a, const void *b)
+{
+    const dc_pole *x = a, *y = b;
+    if (lessqq(x->d, y->d))
+        return -1;
+    if (greaterqq(x->d, y->d))
+        return 1;
+    return (x->col > y->col) - (x->col < y->col);
+}
+
+/* A root x = d[origin]**2 + t of the secular equation, stored relative to
+ * the closer pole, such that the distances to the poles are accurate.
+ */
+typedef struct {
+    long origin;
+    ddouble t;
+} dc_root;
+
+/* Return d[j]**2 - x for the root x */
+static ddouble dc_delta(const ddouble *d, dc_root x, long j)
+{
+    ddouble o = d[x.origin];
+    return subqq(mulqq(subqq(d[j], o), addqq(d[j], o)), x.t);
+}
+
+/* Find the root k of the secular equation
+ *
+ *      f(x) = 1 + sum_j z[j]**2 / (d[j]**2 - x) = 0
+ *
+ * for 0 = d[0] < d[1] < ... < d[nn - 1], which lies between d[k]**2 and
+ * d[k + 1]**2 (or d[k]**2 + zsq for the largest one).  Each step fits one
+ * pole on either side to f and its derivative (the "middle way" of Li and
+ * of LAPACK's dlasd4), safeguarded by bisection.
+ */
+static dc_root dc_secular(const ddouble *d, const ddouble *z, long nn, long k,
+                          ddouble zsq)
+{
+    dc_root x = {k, zsq};
+    ddouble lo = Q_ZERO, hi = zsq;
+    if (nn == 1)
+        return x;
+    if (k < nn - 1) {
+        ddouble gap = mulqq(subqq(d[k + 1], d[k]), addqq(d[k + 1], d[k]));
+        ddouble half = mul_pwr2(gap, 0.5);
+        ddouble f = Q_ONE;
+        x.t = half;
+        for (long j = 0; j < nn; ++j)
+            f = addqq(f, divqq(sqrq(z[j]), dc_delta(d, x, j)));
+        if (signbitq(f)) {
+            x.origin = k + 1;
+            lo = negq(half);
+            hi = Q_ZERO;
+        } else {
+            hi = half;
+        }
+    }
+    x.t = mul_pwr2(addqq(lo, hi), 0.5);
+
+    ddouble prev_step = infq();
+    for (int iter = 0; iter < DC_MAX_ITER; ++iter) {
+        ddouble psi = Q_ZERO, dpsi = Q_ZERO, phi = Q_ZERO, dphi = Q_ZERO;
+        ddouble abs_sum = Q_ONE;
+        for (long j = 0; j < nn; ++j) {
+            ddouble w = divqq(z[j], dc_delta(d, x, j));
+            ddouble term = mulqq(z[j], w);
+            abs_sum = addqq(abs_sum, absq(term));
+            if (j <= k) {
+                psi = addqq(psi, term);
+                dpsi = addqq(dpsi, sqrq(w));
+            } else {
+                phi = addqq(phi, term);
+                dphi = addqq(dphi, sqrq(w));
+            }
+        }
+        ddouble f = addqq(Q_ONE, addqq(psi, phi));
+        if (lessequalqq(absq(f), mulqd(mulqq(Q_EPS, abs_sum), 4.0 * nn)))
+            break;
+        if (signbitq(f))
+            lo = x.t;
+        else
+            hi = x.t;
+
+        /* Solve a0 + s / y + S / (y + g) = 0 for y = d[origin]**2 - x, where
+         * s and S belong to the pole at the origin and the other one.
+         */
+        long o = x.origin;
+        ddouble dk = dc_delta(d, x, k), y = Q_ZERO;
+        ddouble a0 = addqq(Q_ONE, subqq(psi, mulqq(dpsi, dk)));
+        ddouble s = mulqq(dpsi, sqrq(dk));
+        bool ok;
+        if (k == nn - 1) {
+            y = negq(divqq(s, a0));
+            ok = !iszeroq(a0);
+        } else {
+            ddouble dk1 = dc_delta(d, x, k + 1);
+            ddouble S = mulqq(dphi, sqrq(dk1));
+            ddouble g = subqq(dk1, dk);
+            a0 = addqq(a0, subqq(phi, mulqq(dphi, dk1)));
+            if (o != k) {
+                ddouble tmp = s;
+                s = S;
+                S = tmp;
+                g = negq(g);
+            }
+            ddouble b = addqq(mulqq(a0, g), addqq(s, S));
+            ddouble disc = subqq(sqrq(b),
+                                 mul_pwr2(mulqq(a0, mulqq(s, g)), 4.0));
+            ok = !signbitq(disc) && !iszeroq(a0);
+            if (ok) {
+                /* Of the two roots, take the one between the poles */
+                ddouble q = mul_pwr2(addqq(b, copysignqq(sqrtq(disc), b)),
+                                     -0.5);
+                y = divqq(mulqq(s, g), q);
+                ddouble t2 = negq(y);
+                if (!(lessqq(lo, t2) && lessqq(t2, hi)))
+                    y = divqq(q, a0);
+            }
+        }
+
+        ddouble t = ok ? negq(y) : lo;
+        ddouble step = subqq(t, x.t);
+        if (!(lessqq(lo, t) && lessqq(t, hi))
+                || greaterqq(absq(step), mul_pwr2(absq(prev_step), 0.5))) {
+            t = mul_pwr2(addqq(lo, hi), 0.5);
+            step = subqq(t, x.t);
+        }
+        x.t = t;
+        if (lessequalqq(absq(step), mulqq(Q_EPS, absq(t))))
+            break;
+        prev_step = step;
+    }
+    return x;
+}
+
+/* Merge the solved subproblems of the `n` times `n + sqre` bidiagonal
+ * matrix split at row `nl` (LAPACK's dlasd1 to dlasd3):
+ *
+ *      B = [ B1      0      0   ]      B1: nl times nl + 1
+ *          [ alpha  beta    0   ]
+ *          [ 0       0      B2  ]      B2: nr times nr + sqre
+ *
+ * Poles which are negligible or too close to another are deflated, the
+ * others are combined by solving the secular equation, and the singular
+ * vectors are updated with matrix products.
+ */
+static long dc_merge(ddouble *d, long nl, long nr, long sqre, ddouble alpha,
+                     ddouble beta, ddouble *u, long sui, long suj,
+                     ddouble *vt, long svi, long svj, const ddkernels *kern)
+{
+    long n = nl + nr + 1, m = n + sqre;
+    dc_pole *poles = malloc(n * sizeof(dc_pole));
+    long *keep = malloc(2 * n * sizeof(long)), *defl = keep + n;
+    ddouble *work = malloc((4 * n + 2 * n * n + n * m) * sizeof(ddouble));
+    if (poles == NULL || keep == NULL || work == NULL) {
+        free(poles);
+        free(keep);
+        free(work);
+        return -1;
+    }
+    ddouble *dk = work, *zk = dk + n, *zhat = zk + n, *sigma = zhat + n;
+    ddouble *uhat = sigma + n, *vhat = uhat + n * n, *gather = vhat + n * n;
+
+    /* Couple the null columns of the subproblems */
+    ddouble z0 = mulqq(alpha, vt[nl * svi + nl * svj]);
+    if (sqre) {
+        ddouble z2 = mulqq(beta, vt[n * svi + (nl + 1) * svj]), c, s, r;
+        givensq(z0, z2, &c, &s, &r);
+        kern->rot(vt + nl * svi, svj, vt + n * svi, svj, c, s, m);
+        z0 = r;
+    }
+    poles[0] = (dc_pole) {Q_ZERO, z0, nl};
+    for (long q = 0; q < nl; ++q)
+        poles[1 + q] = (dc_pole) {d[q], mulqq(alpha, vt[q * svi + nl * svj]),
+                                  q};
+    for (long q = nl + 1; q < n; ++q)
+        poles[q] = (dc_pole) {d[q], mulqq(beta, vt[q * svi + (nl+1) * svj]),
+                              q};
+    qsort(poles + 1, n - 1, sizeof(dc_pole), dc_pole_cmp);
+
+    /* Deflate (dlasd2) */
+    double dmax = fmax(fabs(poles[n - 1].d.hi),
+                       fmax(fabs(alpha.hi), fabs(beta.hi)));
+    if (dmax == 0.0) {
+        /* The block is zero, so any orthogonal U and VT will do: keep the
+         * ones of the subproblems (dbdsdc returns early for orgnrm = 0),
+         * with e[nl] as the null pole's column.
+         */
+        u[nl * sui + nl * suj] = Q_ONE;
+        free(poles);
+        free(keep);
+        free(work);
+        return 0;
+    }
+    ddouble tol = mulqd(Q_EPS, 64.0 * dmax);
+    if (lessequalqq(absq(poles[0].z), tol))
+        poles[0].z = tol;
+    if (n > 1 && lessqq(poles[1].d, mul_pwr2(tol, 0.5)))
+        poles[1].d = mul_pwr2(tol, 0.5);
+
+    long nkeep = 1, ndefl = 0, prev = -1;
+    keep[0] = 0;
+    for (long j = 1; j < n; ++j) {
+        if (lessequalqq(absq(poles[j].z), tol)) {
+            defl[ndefl++] = j;
+            continue;
+        }
+        if (prev >= 0 && lessequalqq(subqq(poles[j].d, poles[prev].d), tol)) {
+            /* Rotate z[prev] into z[j] */
+            ddouble c, s, r;
+            givensq(poles[j].z, poles[prev].z, &c, &s, &r);
+            long cj = poles[j].col, cp = poles[prev].col;
+            kern->rot(u + cj * suj, sui, u + cp * suj, sui, c, s, n);
+            kern->rot(vt + cj * svi, svj, vt + cp * svi, svj, c, s, m);
+            poles[j].z = r;
+            poles[prev].z = Q_ZERO;
+            defl[ndefl++] = prev;
+        } else if (prev >= 0) {
+            keep[nkeep++] = prev;
+        }
+        prev = j;
+    }
+    if (prev >= 0)
+        keep[nkeep++] = prev;
+
+    long kk = nkeep;
+    ddouble zsq = Q_ZERO;
+    for (long i = 0; i < kk; ++i) {
+        dk[i] = poles[keep[i]].d;
+        zk[i] = poles[keep[i]].z;
+        zsq = addqq(zsq, sqrq(zk[i]));
+    }
+
+    /* Solve the secular equation, then recompute z such that the computed
+     * roots are exact for it, which makes the vectors orthogonal (Gu and
+     * Eisenstat).
+     */
+    dc_root *xs = malloc(kk * sizeof(dc_root));
+    if (xs == NULL) {
+        free(poles);
+        free(keep);
+        free(work);
+        return -1;
+    }
+    #pragma omp parallel for schedule(dynamic) if(kk > 32)
+    for (long k = 0; k < kk; ++k)
+        xs[k] = dc_secular(dk, zk, kk, k, zsq);
+
+    #pragma omp parallel for if(kk > 32)
+    for (long i = 0; i < kk; ++i) {
+        ddouble prod = negq(dc_delta(dk, xs[kk - 1], i));
+        for (long k = 0; k < kk - 1; ++k) {
+            long pole = k < i ? k : k + 1;
+            ddouble den = mulqq(subqq(dk[pole], dk[i]), addqq(dk[pole], dk[i]));
+            prod = mulqq(prod, divqq(negq(dc_delta(dk, xs[k], i)), den));
+        }
+        zhat[i] = copysignqq(sqrtq(absq(prod)), zk[i]);
+    }
+
+    /* Singular vectors of [z.T; diag(d)] as columns of uhat and vhat */
+    #pragma omp parallel for if(kk > 32)
+    for (long k = 0; k < kk; ++k) {
+        ddouble unorm = Q_ONE, vnorm = Q_ZERO;
+        for (long j = 0; j < kk; ++j) {
+            ddouble v = divqq(zhat[j], dc_delta(dk, xs[k], j));
+            ddouble w = mulqq(dk[j], v);
+            vhat[j * kk + k] = v;
+            uhat[j * kk + k] = w;
+            vnorm = addqq(vnorm, sqrq(v));
+            if (j > 0)
+                unorm = addqq(unorm, sqrq(w));
+        }
+        unorm = reciprocalq(sqrtq(unorm));
+        vnorm = reciprocalq(sqrtq(vnorm));
+        uhat[k] = negq(unorm);
+        for (long j = 0; j < kk; ++j) {
+            vhat[j * kk + k] = mulqq(vhat[j * kk + k], vnorm);
+            if (j > 0)
+                uhat[j * kk + k] = mulqq(uhat[j * kk + k], unorm);
+        }
+        ddouble o = dk[xs[k].origin];
+        sigma[k] = sqrtq(addqq(sqrq(o), xs[k].t));
+    }
+    free(xs);
+
+    /* U = [U_keep U_defl] uhat, where the null pole's column is e[nl] */
+    for (long i = 0; i < n; ++i) {
+        for (long j = 1; j < kk; ++j)
+            gather[i * (n - 1) + j - 1] = u[i * sui + poles[keep[j]].col * suj];
+        for (long j = 0; j < ndefl; ++j)
+            gather[i * (n - 1) + kk - 1 + j] =
+                        u[i * sui + poles[defl[j]].col * suj];
+    }
+    kern->matmul(gather, n - 1, 1, uhat + kk, kk, 1, u, sui, suj, n, kk - 1,
+                 kk);
+    for (long k = 0; k < kk; ++k)
+        u[nl * sui + k * suj] = uhat[k];
+    for (long i = 0; i < n; ++i) {
+        for (long j = 0; j < ndefl; ++j)
+            u[i * sui + (kk + j) * suj] = gather[i * (n - 1) + kk - 1 + j];
+    }
+
+    /* VT = vhat.T [VT_keep; VT_defl] */
+    for (long j = 0; j < kk + ndefl; ++j) {
+        long col = poles[j < kk ? keep[j] : defl[j - kk]].col;
+        for (long c = 0; c < m; ++c)
+            gather[j * m + c] = vt[col * svi + c * svj];
+    }
+    kern->matmul(vhat, 1, kk, gather, m, 1, vt, svi, svj, kk, kk, m);
+    for (long j = 0; j < ndefl; ++j) {
+        for (long c = 0; c < m; ++c)
+            vt[(kk + j) * svi + c * svj] = gather[(kk + j) * m + c];
+    }
+
+    for (long k = 0; k < kk; ++k)
+        d[k] = sigma[k];
+    for (long j = 0; j < ndefl; ++j)
+        d[kk + j] = poles[defl[j]].d;
+
+    free(poles);
+    free(keep);
+    free(work);
+    return 0;
+}
+
+static long dc_solve(ddouble *d, ddouble *e, long n, long sqre,
+                     ddouble *u, long sui, long suj,
+                     ddouble *vt, long svi, long svj, const ddkernels *kern)
+{
+    if (n <= DC_LEAF)
+        return dc_leaf(d, e, n, sqre, u, sui, suj, vt, svi, svj, kern);
+
+    long nl = n / 2, nr = n - nl - 1;
+    ddouble alpha = d[nl], beta = e[nl];
+    long info = dc_solve(d, e, nl, 1, u, sui, suj, vt, svi, svj, kern);
+    if (info != 0)
+        return info;
+
+    long off = nl + 1;
+    info = dc_solve(d + off, e + off, nr, sqre, u + off * (sui + suj), sui,
+                    suj, vt + off * (svi + svj), svi, svj, kern);
+    if (info != 0)
+        return info;
+
+    return dc_merge(d, nl, nr, sqre, alpha, beta, u, sui, suj, vt, svi, svj,
+                    kern);
+}
+
+long svd_bidiag_dcq(ddouble *d, ddouble *e, long kk, ddouble *u, long sui,
+                    long suj, ddouble *vt, long svi, long svj,
+                    const ddkernels *kern)
+{
+    for (long i = 0; i < kk; ++i) {
+        for (long j = 0; j < kk; ++j) {
+            u[i * sui + j * suj] = Q_ZERO;
+            vt[i * svi + j * svj] = Q_ZERO;
+        }
+    }
+    return dc_solve(d, e, kk, 0, u, sui, suj, vt, svi, svj, kern);
+}
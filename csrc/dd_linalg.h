@@ -8,6 +8,8 @@
  */
 #pragma once
 #include "dd_arith.h"
+#include "dd_parallel.h"
+#include "dd_simd.h"
 
 /**
  * Apply Givens rotation to vector:
@@ -22,16 +24,11 @@ static inline void lmul_givensq(
     *b = subqq(mulqq(c, y), mulqq(s, x));
 }
 
-/** Compute 2-norm of a vector */
-ddouble normq(const ddouble *x, long nn, long sxn);
-
 /**
- * Perform a rank-one update of a `ii` times `jj` matrix:
- *
- *       A[i, j] += v[i] * w[j]
+ * Compute 2-norm of a vector, splitting the sum of squares across threads
+ * according to `par`.  Use `&DD_SERIAL` to run serially.
  */
-void rank1updateq(ddouble *a, long ais, long ajs, const ddouble *v, long vs,
-                  const ddouble *w, long ws, long ii, long jj);
+ddouble normq(const ddouble *x, long nn, long sxn, const ddparallel *par);
 
 /**
  * Compute Givens rotation `R` matrix that satisfies:
@@ -51,6 +48,88 @@ void givensq(ddouble f, ddouble g, ddouble *c, ddouble *s, ddouble *r);
  */
 ddouble householderq(const ddouble *x, ddouble *v, long nn, long sx, long sv);
 
+/**
+ * Compute the QR decomposition of a `ii` times `jj` matrix A in place, using
+ * blocked Householder reflections, where the trailing matrix is updated by
+ * matrix products (compact WY representation).
+ *
+ * On exit, the upper triangle of A holds R, while the reflector `v` of each
+ * column `j < min(ii, jj)` is stored below the diagonal, with an implicit
+ * `v[0] = 1`, and the corresponding scaling factor in `tau[j * stau]`; the
+ * remaining elements of `tau` are set to zero.  This is the format of
+ * LAPACK's geqrf.  The matrix products are computed using `kern`.
+ *
+ * Returns false if no memory could be allocated for the blocked algorithm,
+ * in which case the unblocked algorithm was used instead.
+ */
+bool householder_qrq(ddouble *a, long sai, long saj, ddouble *tau, long stau,
+                     long ii, long jj, const ddkernels *kern);
+
+/**
+ * Apply the product of Householder reflectors `Q = H[0] ... H[kk - 1]`, or
+ * its transpose if `trans` is set, to a `ii` times `jj` matrix B in place:
+ *
+ *      B = Q @ B    or    B = Q.T @ B
+ *
+ * The reflectors are stored in the `ii` times `kk` matrix `h` in the format
+ * of householder_qrq(), except that `tau` is stored on the diagonal.  They
+ * are applied in blocks using matrix products.  If `unit` is set, B is
+ * overwritten with the first `jj` columns of the identity first, i.e., Q
+ * (or Q.T) is formed; for Q, this skips the work on columns known to be
+ * unchanged.
+ *
+ * Returns false if no memory could be allocated for the blocked algorithm,
+ * in which case the reflectors were applied one by one.
+ */
+bool householder_applyq(const ddouble *h, long shi, long shk, long ii,
+                        long kk, ddouble *b, long sbi, long sbj, long jj,
+                        bool trans, bool unit, const ddkernels *kern);
+
+/**
+ * Compute the rank-revealing QR decomposition of a `ii` times `jj` matrix A
+ * in place, using Householder reflections with column pivoting:
+ *
+ *      A[:, jpvt] = Q @ R
+ *
+ * At each step, the remaining column of largest norm is chosen as pivot,
+ * where the column norms are downdated rather than recomputed (LAPACK's
+ * dgeqp3).  The factorization stops after the first step `k` for which
+ * `abs(R[k, k] / R[0, 0]) < tol`, and the rank `k + 1` (or `min(ii, jj)`)
+ * is returned.  A holds R and the reflectors in the format of
+ * householder_qrq(), `tau` beyond the rank is set to zero.
+ *
+ * Returns -1 if no memory could be allocated.
+ */
+long householder_rrqrq(ddouble *a, long sai, long saj, ddouble *tau, long stau,
+                       long *jpvt, long ii, long jj, ddouble tol,
+                       const ddkernels *kern);
+
+/**
+ * Compute the LU decomposition with partial pivoting of a `nn` times `nn`
+ * matrix A in place (LAPACK's dgetrf):
+ *
+ *      A = P @ L @ U
+ *
+ * On exit, A holds U in its upper triangle and L, which has unit diagonal,
+ * below it.  Row `j` was swapped with row `piv[j] >= j` in step `j`.  The
+ * factorization is blocked, where the trailing matrix is updated by matrix
+ * products computed using `kern`.
+ *
+ * Returns zero on success, `j + 1` if `U[j, j]` is exactly zero (the
+ * factorization is completed nevertheless), or -1 if no memory could be
+ * allocated.
+ */
+long lu_factorq(ddouble *a, long sai, long saj, long *piv, long nn,
+                const ddkernels *kern);
+
+/**
+ * Solve A @ X = B in place for the `nn` times `kk` matrix B, where A and
+ * `piv` hold the LU decomposition computed by lu_factorq().
+ */
+void lu_solveq(const ddouble *a, long sai, long saj, const long *piv,
+               long nn, ddouble *b, long sbi, long sbj, long kk,
+               const ddkernels *kern);
+
 /**
  * Perform the SVD of an arbitrary two-by-two matrix:
  *
@@ -61,10 +140,62 @@ void svd_2x2(ddouble a11, ddouble a12, ddouble a21, ddouble a22, ddouble *smin,
              ddouble *smax, ddouble *cv, ddouble *sv, ddouble *cu, ddouble *su);
 
 
-
+/**
+ * Perform one sweep of one-sided Jacobi rotations on the columns of the
+ * `ii` times `jj` matrix U, where `ii >= jj`, applying the same rotations
+ * to the rows of the `jj` times `jj` matrix VT.  Each pair of columns is
+ * orthogonalized once in cyclic order, where the larger column is kept
+ * first, and independent pairs are processed in parallel.  Pairs that are
+ * already orthogonal to working precision are skipped.
+ *
+ * If `block > 1`, the columns are split into blocks of that size, and each
+ * pair of blocks is orthogonalized at once through its Gram matrix.
+ *
+ * Returns the norm of the non-negligible off-diagonal part of U.T U before
+ * the rotations, which is zero once the sweep has converged, or NaN on
+ * error.
+ */
 ddouble jacobi_sweep(ddouble *u, long sui, long suj, ddouble *vt, long svi,
-                     long svj, long ii, long jj);
+                     long svj, long ii, long jj, long block,
+                     const ddkernels *kern);
 
 
 void golub_kahan_chaseq(ddouble *d, long sd, ddouble *e, long se, long ii,
                         ddouble *rot);
+
+/**
+ * Diagonalize the `kk` times `kk` upper bidiagonal matrix B with diagonal
+ * `d` and superdiagonal `e` (of length `kk - 1`) by implicit-shift QR steps
+ * (Golub-Kahan), deflating negligible elements of `e` in between.  The left
+ * rotations are applied to the columns of the `ii` times `kk` matrix U and
+ * the right ones to the rows of the `kk` times `jj` matrix VT, such that
+ * U B VT is preserved.  On exit, `d` holds the singular values, unsorted and
+ * with arbitrary sign.
+ *
+ * `rot` is a buffer for `4 * kk` elements.  Returns 0 on success, or (like
+ * LAPACK's dbdsqr) the number of nonzero elements left in `e` if the
+ * iteration did not converge within `max_iter` QR steps.
+ */
+long svd_bidiagq(ddouble *d, long sd, ddouble *e, long se, long kk,
+                 ddouble *u, long sui, long suj, long ii,
+                 ddouble *vt, long svi, long svj, long jj, long max_iter,
+                 ddouble *rot, const ddkernels *kern);
+
+/**
+ * Compute the SVD of the `kk` times `kk` upper bidiagonal matrix B with
+ * diagonal `d` and superdiagonal `e` by divide and conquer (LAPACK's
+ * dbdsdc):
+ *
+ *      B = U diag(d) VT
+ *
+ * Subproblems are solved by svd_bidiagq(), and merged by solving the
+ * secular equation, where the update of the singular vectors is done by
+ * matrix products.  U and VT are `kk` times `kk` outputs, `d` is
+ * overwritten with the singular values (unsorted), and `e` is destroyed.
+ *
+ * Returns 0 on success, -1 if no memory could be allocated, or a positive
+ * number if a subproblem did not converge.
+ */
+long svd_bidiag_dcq(ddouble *d, ddouble *e, long kk, ddouble *u, long sui,
+                    long suj, ddouble *vt, long svi, long svj,
+                    const ddkernels *kern);
@@ -0,0 +1,101 @@
+/* Helpers for splitting work across OpenMP threads.
+ *
+ * Copyright (C) 2021 Markus Wallerberger and others
+ * SPDX-License-Identifier: MIT
+ */
+#include "dd_parallel.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Maximum number of partial results of a reduction */
+enum { MAX_BLOCKS = 1024 };
+
+long dd_parallel_chunks(const ddparallel *par, long nn, long cost)
+{
+    long nchunks = 1;
+#ifdef _OPENMP
+    /* Guard against items without cost and against overflow for huge
+     * grain sizes such as the one of DD_SERIAL
+     */
+    long items = par->grain_size / (cost > 1 ? cost : 1);
+    if (items >= nn)
+        return 1;
+    nchunks = nn / (items + 1);
+    if (nchunks > omp_get_max_threads())
+        nchunks = omp_get_max_threads();
+    if (nchunks < 1)
+        nchunks = 1;
+#else
+    (void) par;
+    (void) nn;
+    (void) cost;
+#endif
+    return nchunks;
+}
+
+static ddouble reduce_threads(const ddparallel *par, ddreduce_block block,
+                              ddouble (*combine)(ddouble, ddouble),
+                              const void *args, long nn, long cost)
+{
+    long nchunks = dd_parallel_chunks(par, nn, cost);
+    if (nchunks > MAX_BLOCKS)
+        nchunks = MAX_BLOCKS;
+    if (nchunks < 2)
+        return block(args, 0, nn);
+
+    ddouble partial[MAX_BLOCKS];
+    #pragma omp parallel for
+    for (long c = 0; c < nchunks; ++c) {
+        long start = c * nn / nchunks;
+        long size = (c + 1) * nn / nchunks - start;
+        partial[c] = block(args, start, size);
+    }
+
+    ddouble result = partial[0];
+    for (long c = 1; c < nchunks; ++c)
+        result = combine(result, partial[c]);
+    return result;
+}
+
+static ddouble reduce_blocks(const ddparallel *par, ddreduce_block block,
+                             ddouble (*combine)(ddouble, ddouble),
+                             const void *args, long nn, long cost)
+{
+    /* The block size is doubled until there are at most MAX_BLOCKS blocks,
+     * so it depends on nn only.
+     */
+    long block_size = DD_REDUCE_BLOCK;
+    while (nn > block_size * MAX_BLOCKS)
+        block_size *= 2;
+
+    long nblocks = (nn + block_size - 1) / block_size;
+    if (nblocks < 2)
+        return block(args, 0, nn);
+
+    ddouble partial[MAX_BLOCKS];
+    #pragma omp parallel for if(dd_parallel_chunks(par, nn, cost) > 1)
+    for (long b = 0; b < nblocks; ++b) {
+        long start = b * block_size;
+        long size = start + block_size < nn ? block_size : nn - start;
+        partial[b] = block(args, start, size);
+    }
+
+    /* Combine partial results pairwise */
+    for (long w = 1; w < nblocks; w *= 2) {
+        for (long b = 0; b + w < nblocks; b += 2 * w)
+            partial[b] = combine(partial[b], partial[b + w]);
+    }
+    return partial[0];
+}
+
+ddouble dd_parallel_reduce(const ddparallel *par, ddreduce_block block,
+                           ddouble (*combine)(ddouble, ddouble),
+                           const void *args, long nn, long cost)
+{
+    if (par->deterministic)
+        return reduce_blocks(par, block, combine, args, nn, cost);
+    else
+        return reduce_threads(par, block, combine, args, nn, cost);
+}
@@ -0,0 +1,64 @@
+/* Helpers for splitting work across OpenMP threads.
+ *
+ * Copyright (C) 2021 Markus Wallerberger and others
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <limits.h>
+#include "dd_arith.h"
+
+/**
+ * Settings for parallel execution.
+ *
+ * The settings are owned by the `_dd_ufunc` module, which exports a pointer
+ * to them as the capsule `xprec._dd_ufunc._parallel`, so that they are
+ * shared by all extension modules.
+ */
+typedef struct {
+    /**
+     * Minimum work per thread, measured in units of the cost of one ddouble
+     * addition.  Smaller problems are processed serially.
+     */
+    long grain_size;
+
+    /**
+     * If true, reductions are split into blocks of fixed size, which are
+     * combined in a fixed order, so the result does not depend on the number
+     * of threads.  Otherwise, there is one block per thread.
+     */
+    bool deterministic;
+} ddparallel;
+
+/** Settings for serial execution with the deterministic blocking */
+static const ddparallel DD_SERIAL = { LONG_MAX, true };
+
+/**
+ * Minimum number of elements per block of a deterministic reduction.  This
+ * should be a multiple of REDUCE_BLOCK in dd_simd.c.
+ */
+#define DD_REDUCE_BLOCK 8192
+
+/**
+ * Return the number of threads to split `nn` items of work `cost` each
+ * across.
+ */
+long dd_parallel_chunks(const ddparallel *par, long nn, long cost);
+
+/**
+ * Partial reduction over the items `start` to `start + size - 1`, where
+ * `args` is the pointer passed to `dd_parallel_reduce()`.
+ */
+typedef ddouble (*ddreduce_block)(const void *args, long start, long size);
+
+/**
+ * Reduce `nn` items of work `cost` each by splitting them into blocks,
+ * reducing each block using `block` and combining the partial results
+ * using `combine`.
+ *
+ * If `par->deterministic` is set, the blocks have a size that only depends
+ * on `nn` and the partial results are combined pairwise, so the result does
+ * not depend on the number of threads.
+ */
+ddouble dd_parallel_reduce(const ddparallel *par, ddreduce_block block,
+                           ddouble (*combine)(ddouble, ddouble),
+                           const void *args, long nn, long cost);
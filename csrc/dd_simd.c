@@ -0,0 +1,1152 @@
+/* Vectorized double-double kernels, dispatched by instruction set.
+ *
+ * Copyright (C) 2021 Markus Wallerberger and others
+ * SPDX-License-Identifier: MIT
+ */
+#include "dd_simd.h"
+
+#include <string.h>
+
+/* The vector kernels operate on `DD_VEC_WIDTH` elements at once.  Each
+ * block of elements is deinterleaved into a register of high parts and a
+ * register of low parts, such that the algorithms from dd_arith.h can be
+ * applied lane-wise without any change in the order of operations.  Which
+ * path is taken is determined by the instruction set the file is compiled
+ * for (see dd_dispatch.h); without AVX2/FMA or AVX-512, only the scalar loop
+ * is used.
+ */
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define DD_VEC_WIDTH 8
+
+typedef __m512d vdouble;
+
+#define vadd _mm512_add_pd
+#define vsub _mm512_sub_pd
+#define vmul _mm512_mul_pd
+#define vdiv _mm512_div_pd
+#define vfma _mm512_fmadd_pd
+#define vfms _mm512_fmsub_pd
+#define vset1 _mm512_set1_pd
+#define vloadu _mm512_loadu_pd
+#define vstoreu _mm512_storeu_pd
+
+static inline vdouble vxor(vdouble a, vdouble b)
+{
+    /* _mm512_xor_pd would require AVX512DQ */
+    return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a),
+                                                _mm512_castpd_si512(b)));
+}
+
+#elif defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define DD_VEC_WIDTH 4
+
+typedef __m256d vdouble;
+
+#define vadd _mm256_add_pd
+#define vsub _mm256_sub_pd
+#define vmul _mm256_mul_pd
+#define vdiv _mm256_div_pd
+#define vfma _mm256_fmadd_pd
+#define vfms _mm256_fmsub_pd
+#define vset1 _mm256_set1_pd
+#define vloadu _mm256_loadu_pd
+#define vstoreu _mm256_storeu_pd
+#define vxor _mm256_xor_pd
+
+#endif
+
+#ifdef DD_VEC_WIDTH
+
+typedef struct {
+    vdouble hi;
+    vdouble lo;
+} vddouble;
+
+/* Loads and stores.  Unpacking the high and low parts from two registers
+ * permutes the elements, (0, 2, 1, 3) for AVX2 and (0, 4, 1, 5, ...) for
+ * AVX-512.  Plain doubles and strided elements (`vload_qs`) are loaded in the
+ * same order, and the stores undo the permutation.
+ */
+#if DD_VEC_WIDTH == 8
+
+static inline vddouble vload_q(const ddouble *p)
+{
+    vdouble x0 = _mm512_loadu_pd((const double *)p);
+    vdouble x1 = _mm512_loadu_pd((const double *)(p + 4));
+    return (vddouble){_mm512_unpacklo_pd(x0, x1), _mm512_unpackhi_pd(x0, x1)};
+}
+
+static inline void vstore_q(ddouble *p, vddouble x)
+{
+    _mm512_storeu_pd((double *)p, _mm512_unpacklo_pd(x.hi, x.lo));
+    _mm512_storeu_pd((double *)(p + 4), _mm512_unpackhi_pd(x.hi, x.lo));
+}
+
+static inline vdouble vload_d(const double *p)
+{
+    const __m512i perm = _mm512_set_epi64(7, 3, 6, 2, 5, 1, 4, 0);
+    return _mm512_permutexvar_pd(perm, _mm512_loadu_pd(p));
+}
+
+static inline vddouble vload_qs(const ddouble *p, long s)
+{
+    return (vddouble){
+        _mm512_set_pd(p[7*s].hi, p[3*s].hi, p[6*s].hi, p[2*s].hi,
+                      p[5*s].hi, p[1*s].hi, p[4*s].hi, p[0*s].hi),
+        _mm512_set_pd(p[7*s].lo, p[3*s].lo, p[6*s].lo, p[2*s].lo,
+                      p[5*s].lo, p[1*s].lo, p[4*s].lo, p[0*s].lo)};
+}
+
+#else
+
+static inline vddouble vload_q(const ddouble *p)
+{
+    vdouble x0 = _mm256_loadu_pd((const double *)p);
+    vdouble x1 = _mm256_loadu_pd((const double *)(p + 2));
+    return (vddouble){_mm256_unpacklo_pd(x0, x1), _mm256_unpackhi_pd(x0, x1)};
+}
+
+static inline void vstore_q(ddouble *p, vddouble x)
+{
+    _mm256_storeu_pd((double *)p, _mm256_unpacklo_pd(x.hi, x.lo));
+    _mm256_storeu_pd((double *)(p + 2), _mm256_unpackhi_pd(x.hi, x.lo));
+}
+
+static inline vdouble vload_d(const double *p)
+{
+    return _mm256_permute4x64_pd(_mm256_loadu_pd(p), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+static inline vddouble vload_qs(const ddouble *p, long s)
+{
+    return (vddouble){
+        _mm256_set_pd(p[3*s].hi, p[1*s].hi, p[2*s].hi, p[0*s].hi),
+        _mm256_set_pd(p[3*s].lo, p[1*s].lo, p[2*s].lo, p[0*s].lo)};
+}
+
+#endif
+
+/* Lane-wise versions of the algorithms in dd_arith.h */
+
+static inline vddouble v_two_sum_quick(vdouble a, vdouble b)
+{
+    vdouble s = vadd(a, b);
+    vdouble lo = vsub(b, vsub(s, a));
+    return (vddouble){s, lo};
+}
+
+static inline vddouble v_two_sum(vdouble a, vdouble b)
+{
+    vdouble s = vadd(a, b);
+    vdouble v = vsub(s, a);
+    vdouble lo = vadd(vsub(a, vsub(s, v)), vsub(b, v));
+    return (vddouble){s, lo};
+}
+
+static inline vddouble v_two_diff(vdouble a, vdouble b)
+{
+    vdouble s = vsub(a, b);
+    vdouble v = vsub(s, a);
+    vdouble lo = vsub(vsub(a, vsub(s, v)), vadd(b, v));
+    return (vddouble){s, lo};
+}
+
+static inline vddouble v_two_prod(vdouble a, vdouble b)
+{
+    vdouble s = vmul(a, b);
+    vdouble lo = vfms(a, b, s);
+    return (vddouble){s, lo};
+}
+
+static inline vddouble v_negq(vddouble a)
+{
+    const vdouble sign = vset1(-0.0);
+    return (vddouble){vxor(a.hi, sign), vxor(a.lo, sign)};
+}
+
+static inline vddouble v_addqd(vddouble x, vdouble y)
+{
+    vddouble s = v_two_sum(x.hi, y);
+    vdouble v = vadd(x.lo, s.lo);
+    return v_two_sum_quick(s.hi, v);
+}
+
+static inline vddouble v_subqd(vddouble x, vdouble y)
+{
+    vddouble s = v_two_diff(x.hi, y);
+    vdouble v = vadd(x.lo, s.lo);
+    return v_two_sum_quick(s.hi, v);
+}
+
+static inline vddouble v_mulqd(vddouble x, vdouble y)
+{
+    vddouble c = v_two_prod(x.hi, y);
+    vdouble v = vfma(x.lo, y, c.lo);
+    return v_two_sum_quick(c.hi, v);
+}
+
+static inline vddouble v_divqd(vddouble x, vdouble y)
+{
+    vdouble t_hi = vdiv(x.hi, y);
+    vddouble pi = v_two_prod(t_hi, y);
+    vdouble d_hi = vsub(x.hi, pi.hi);
+    vdouble d_lo = vsub(x.lo, pi.lo);
+    vdouble t_lo = vdiv(vadd(d_hi, d_lo), y);
+    return v_two_sum_quick(t_hi, t_lo);
+}
+
+static inline vddouble v_reciprocalq(vddouble y)
+{
+    const vdouble one = vset1(1.0);
+    vdouble t_hi = vdiv(one, y.hi);
+    vddouble r = v_mulqd(y, t_hi);
+    vdouble pi_hi = vsub(one, r.hi);
+    vdouble d = vsub(pi_hi, r.lo);
+    vdouble t_lo = vdiv(d, y.hi);
+    return v_two_sum_quick(t_hi, t_lo);
+}
+
+static inline vddouble v_adddq(vdouble x, vddouble y)
+{
+    return v_addqd(y, x);
+}
+
+static inline vddouble v_subdq(vdouble x, vddouble y)
+{
+    return v_addqd(v_negq(y), x);
+}
+
+static inline vddouble v_muldq(vdouble x, vddouble y)
+{
+    return v_mulqd(y, x);
+}
+
+static inline vddouble v_divdq(vdouble x, vddouble y)
+{
+    return v_mulqd(v_reciprocalq(y), x);
+}
+
+static inline vddouble v_addqq(vddouble x, vddouble y)
+{
+    vddouble s = v_two_sum(x.hi, y.hi);
+    vddouble t = v_two_sum(x.lo, y.lo);
+    vddouble v = v_two_sum_quick(s.hi, vadd(s.lo, t.hi));
+    return v_two_sum_quick(v.hi, vadd(t.lo, v.lo));
+}
+
+static inline vddouble v_subqq(vddouble x, vddouble y)
+{
+    vddouble s = v_two_diff(x.hi, y.hi);
+    vddouble t = v_two_diff(x.lo, y.lo);
+    vddouble v = v_two_sum_quick(s.hi, vadd(s.lo, t.hi));
+    return v_two_sum_quick(v.hi, vadd(t.lo, v.lo));
+}
+
+static inline vddouble v_mulqq(vddouble a, vddouble b)
+{
+    vddouble c = v_two_prod(a.hi, b.hi);
+    vdouble t = vmul(a.hi, b.lo);
+    t = vfma(a.lo, b.hi, t);
+    return v_two_sum_quick(c.hi, vadd(c.lo, t));
+}
+
+static inline vddouble v_divqq(vddouble x, vddouble y)
+{
+    vdouble t_hi = vdiv(x.hi, y.hi);
+    vddouble r = v_mulqd(y, t_hi);
+    vdouble pi_hi = vsub(x.hi, r.hi);
+    vdouble d = vadd(pi_hi, vsub(x.lo, r.lo));
+    vdouble t_lo = vdiv(d, y.hi);
+    return v_two_sum_quick(t_hi, t_lo);
+}
+
+#define VEC_BLOCKS(vfunc, vload_a, vload_b)                             \
+        for (; i + DD_VEC_WIDTH <= nn; i += DD_VEC_WIDTH)               \
+            vstore_q(c + i, vfunc(vload_a(a + i), vload_b(b + i)));
+
+#if DD_VEC_WIDTH == 8
+
+#define VEC_REDUCE(vfunc, vload_a)                                      \
+        if (sa == 1) {                                                  \
+            vddouble v = vload_q(acc);                                  \
+            for (; i + 8 <= nn; i += 8)                                 \
+                v = vfunc(v, vload_a(a + i));                           \
+            vstore_q(acc, v);                                           \
+        }
+
+#else
+
+#define VEC_REDUCE(vfunc, vload_a)                                      \
+        if (sa == 1) {                                                  \
+            vddouble v0 = vload_q(acc), v1 = vload_q(acc + 4);          \
+            for (; i + 8 <= nn; i += 8) {                               \
+                v0 = vfunc(v0, vload_a(a + i));                         \
+                v1 = vfunc(v1, vload_a(a + i + 4));                     \
+            }                                                           \
+            vstore_q(acc, v0);                                          \
+            vstore_q(acc + 4, v1);                                      \
+        }
+
+#endif
+
+#define VEC_DOT(vload_a, vload_b)                                       \
+        {                                                               \
+            enum { NV = DOT_ACC / DD_VEC_WIDTH };                       \
+            vddouble v[NV];                                             \
+            for (int k = 0; k != NV; ++k)                               \
+                v[k] = vload_q(acc + k * DD_VEC_WIDTH);                 \
+            for (; i + DOT_ACC <= nn; i += DOT_ACC) {                   \
+                for (int k = 0; k != NV; ++k) {                         \
+                    long j = i + k * DD_VEC_WIDTH;                      \
+                    vddouble p = v_mulqq(vload_a(a + j * sa, sa),       \
+                                         vload_b(b + j * sb, sb));      \
+                    v[k] = v_addqq(v[k], p);                            \
+                }                                                       \
+            }                                                           \
+            for (int k = 0; k != NV; ++k)                               \
+                vstore_q(acc + k * DD_VEC_WIDTH, v[k]);                 \
+        }
+
+/* Contiguous load with the signature of vload_qs */
+#define vload_q1(p, s) vload_q(p)
+
+#else
+
+#define VEC_BLOCKS(vfunc, vload_a, vload_b)
+#define VEC_REDUCE(vfunc, vload_a)
+
+#endif /* DD_VEC_WIDTH */
+
+#define VEC_BINARY(name, vfunc, sfunc, type_a, vload_a, type_b, vload_b) \
+    static void name(const type_a *a, const type_b *b, ddouble *c,      \
+                     long nn)                                           \
+    {                                                                   \
+        long i = 0;                                                     \
+        VEC_BLOCKS(vfunc, vload_a, vload_b)                             \
+        for (; i < nn; ++i)                                             \
+            c[i] = sfunc(a[i], b[i]);                                   \
+    }
+
+VEC_BINARY(addqq_vec, v_addqq, addqq, ddouble, vload_q, ddouble, vload_q)
+VEC_BINARY(subqq_vec, v_subqq, subqq, ddouble, vload_q, ddouble, vload_q)
+VEC_BINARY(mulqq_vec, v_mulqq, mulqq, ddouble, vload_q, ddouble, vload_q)
+VEC_BINARY(divqq_vec, v_divqq, divqq, ddouble, vload_q, ddouble, vload_q)
+
+VEC_BINARY(addqd_vec, v_addqd, addqd, ddouble, vload_q, double, vload_d)
+VEC_BINARY(subqd_vec, v_subqd, subqd, ddouble, vload_q, double, vload_d)
+VEC_BINARY(mulqd_vec, v_mulqd, mulqd, ddouble, vload_q, double, vload_d)
+VEC_BINARY(divqd_vec, v_divqd, divqd, ddouble, vload_q, double, vload_d)
+
+VEC_BINARY(adddq_vec, v_adddq, adddq, double, vload_d, ddouble, vload_q)
+VEC_BINARY(subdq_vec, v_subdq, subdq, double, vload_d, ddouble, vload_q)
+VEC_BINARY(muldq_vec, v_muldq, muldq, double, vload_d, ddouble, vload_q)
+VEC_BINARY(divdq_vec, v_divdq, divdq, double, vload_d, ddouble, vload_q)
+
+/* Reductions keep eight independent accumulators, where accumulator k
+ * combines the elements k, k + 8, k + 16, etc., which breaks the dependency
+ * chain between consecutive elements.  Since this assignment does not
+ * depend on the vector width, the result is the same for every instruction
+ * set.  The accumulators are combined pairwise, as are the results for
+ * blocks of REDUCE_BLOCK elements.  Elements of type `type_a` are added to
+ * the accumulators with `sfunc`, while `combine` adds two accumulators.
+ */
+#define REDUCE_BLOCK 1024
+
+#define KERNEL_REDUCE(name, type_a, vload_a, vfunc, sfunc, combine,      \
+                      identity)                                         \
+    static ddouble name##_block(const type_a *a, long sa, long nn)      \
+    {                                                                   \
+        ddouble acc[8];                                                 \
+        long i = 0;                                                     \
+        for (int k = 0; k != 8; ++k)                                    \
+            acc[k] = identity;                                          \
+        VEC_REDUCE(vfunc, vload_a)                                      \
+        for (; i + 8 <= nn; i += 8) {                                   \
+            for (int k = 0; k != 8; ++k)                                \
+                acc[k] = sfunc(acc[k], a[(i + k) * sa]);                \
+        }                                                               \
+        for (int k = 0; i < nn; ++i, ++k)                               \
+            acc[k] = sfunc(acc[k], a[i * sa]);                          \
+        for (int w = 4; w != 0; w /= 2) {                               \
+            for (int k = 0; k != w; ++k)                                \
+                acc[k] = combine(acc[k], acc[k + w]);                   \
+        }                                                               \
+        return acc[0];                                                  \
+    }                                                                   \
+                                                                        \
+    static ddouble name(const type_a *a, long sa, long nn)              \
+    {                                                                   \
+        if (nn <= REDUCE_BLOCK)                                         \
+            return name##_block(a, sa, nn);                             \
+        long half = nn / 2;                                             \
+        ddouble left = name(a, sa, half);                               \
+        return combine(left, name(a + half * sa, sa, nn - half));       \
+    }
+
+KERNEL_REDUCE(sumq_loop, ddouble, vload_q, v_addqq, addqq, addqq, Q_ZERO)
+KERNEL_REDUCE(prodq_loop, ddouble, vload_q, v_mulqq, mulqq, mulqq, Q_ONE)
+KERNEL_REDUCE(sumd_loop, double, vload_d, v_addqd, addqd, addqq, Q_ZERO)
+
+/* Compiling the scalar functions for the target instruction set already pays
+ * off, since fma() is otherwise a library call.
+ */
+#define KERNEL_UNARY(name, func)                                        \
+    static void name(const ddouble *a, long sa, ddouble *b, long sb,    \
+                     long nn)                                           \
+    {                                                                   \
+        for (long i = 0; i < nn; ++i)                                   \
+            b[i * sb] = func(a[i * sa]);                                \
+    }
+
+KERNEL_UNARY(sqrtq_loop, sqrtq)
+KERNEL_UNARY(expq_loop, expq)
+KERNEL_UNARY(expm1q_loop, expm1q)
+KERNEL_UNARY(logq_loop, logq)
+KERNEL_UNARY(log2q_loop, log2q)
+KERNEL_UNARY(log10q_loop, log10q)
+KERNEL_UNARY(log1pq_loop, log1pq)
+KERNEL_UNARY(sinq_loop, sinq)
+KERNEL_UNARY(cosq_loop, cosq)
+
+static void sincosq_loop(const ddouble *a, long sa, ddouble *b, long sb,
+                         ddouble *c, long sc, long nn)
+{
+    for (long i = 0; i < nn; ++i)
+        sincosq(a[i * sa], &b[i * sb], &c[i * sc]);
+}
+
+KERNEL_UNARY(sinhq_loop, sinhq)
+KERNEL_UNARY(coshq_loop, coshq)
+KERNEL_UNARY(tanhq_loop, tanhq)
+
+/* The dot product has more work per element, so it uses sixteen
+ * accumulators instead of eight, but otherwise proceeds like the reductions
+ * above.  Strided vectors are gathered into vector registers element by
+ * element, which is still much faster than the scalar code, since the
+ * arithmetic dominates.
+ */
+#define DOT_ACC 16
+
+static ddouble dotq_block(const ddouble *a, long sa, const ddouble *b,
+                          long sb, long nn)
+{
+    ddouble acc[DOT_ACC];
+    long i = 0;
+    for (int k = 0; k != DOT_ACC; ++k)
+        acc[k] = Q_ZERO;
+#ifdef DD_VEC_WIDTH
+    if (sa == 1 && sb == 1)
+        VEC_DOT(vload_q1, vload_q1)
+    else
+        VEC_DOT(vload_qs, vload_qs)
+#endif
+    for (; i + DOT_ACC <= nn; i += DOT_ACC) {
+        for (int k = 0; k != DOT_ACC; ++k)
+            acc[k] = addqq(acc[k], mulqq(a[(i + k) * sa], b[(i + k) * sb]));
+    }
+    for (int k = 0; i < nn; ++i, ++k)
+        acc[k] = addqq(acc[k], mulqq(a[i * sa], b[i * sb]));
+    for (int w = DOT_ACC / 2; w != 0; w /= 2) {
+        for (int k = 0; k != w; ++k)
+            acc[k] = addqq(acc[k], acc[k + w]);
+    }
+    return acc[0];
+}
+
+static ddouble dotq_loop(const ddouble *a, long sa, const ddouble *b, long sb,
+                         long nn)
+{
+    if (nn <= REDUCE_BLOCK)
+        return dotq_block(a, sa, b, sb, nn);
+    long half = nn / 2;
+    ddouble left = dotq_loop(a, sa, b, sb, half);
+    return addqq(left, dotq_loop(a + half * sa, sa, b + half * sb, sb,
+                                 nn - half));
+}
+
+/* Accurate dot product and sum of double vectors, following Dot2 and Sum2
+ * of Ogita, Rump and Oishi: each accumulator keeps a running sum p in
+ * double, while the rounding errors of the additions and products, which
+ * are exact by two_sum and two_prod, are collected in s.  The accumulators
+ * are assigned as in dotq_block; since the inputs are plain doubles, their
+ * lanes are loaded in order, without permutation.
+ */
+#ifdef DD_VEC_WIDTH
+
+#if DD_VEC_WIDTH == 8
+static inline vdouble vloadu_s(const double *p, long s)
+{
+    return _mm512_set_pd(p[7*s], p[6*s], p[5*s], p[4*s],
+                         p[3*s], p[2*s], p[1*s], p[0*s]);
+}
+#else
+static inline vdouble vloadu_s(const double *p, long s)
+{
+    return _mm256_set_pd(p[3*s], p[2*s], p[1*s], p[0*s]);
+}
+#endif
+
+/* Contiguous load with the signature of vloadu_s */
+#define vloadu1(p, s) vloadu(p)
+
+#define VEC_ACCURATE(vterm)                                             \
+        {                                                               \
+            enum { NV = DOT_ACC / DD_VEC_WIDTH };                       \
+            vdouble vp[NV], vs[NV];                                     \
+            for (int k = 0; k != NV; ++k) {                             \
+                vp[k] = vloadu(p + k * DD_VEC_WIDTH);                   \
+                vs[k] = vloadu(s + k * DD_VEC_WIDTH);                   \
+            }                                                           \
+            for (; i + DOT_ACC <= nn; i += DOT_ACC) {                   \
+                for (int k = 0; k != NV; ++k) {                         \
+                    long j = i + k * DD_VEC_WIDTH;                      \
+                    vterm                                               \
+                }                                                       \
+            }                                                           \
+            for (int k = 0; k != NV; ++k) {                             \
+                vstoreu(p + k * DD_VEC_WIDTH, vp[k]);                   \
+                vstoreu(s + k * DD_VEC_WIDTH, vs[k]);                   \
+            }                                                           \
+        }
+
+#define VEC_DOT2(vload_a, vload_b)                                      \
+        VEC_ACCURATE(                                                   \
+            vddouble h = v_two_prod(vload_a(a + j * sa, sa),            \
+                                    vload_b(b + j * sb, sb));           \
+            vddouble t = v_two_sum(vp[k], h.hi);                        \
+            vp[k] = t.hi;                                               \
+            vs[k] = vadd(vs[k], vadd(t.lo, h.lo));                      \
+        )
+
+#define VEC_SUM2(vload_a)                                               \
+        VEC_ACCURATE(                                                   \
+            vddouble t = v_two_sum(vp[k], vload_a(a + j * sa, sa));     \
+            vp[k] = t.hi;                                               \
+            vs[k] = vadd(vs[k], t.lo);                                  \
+        )
+
+#endif /* DD_VEC_WIDTH */
+
+static inline void dot2_step(double *p, double *s, double a, double b)
+{
+    ddouble h = two_prod(a, b);
+    ddouble t = two_sum(*p, h.hi);
+    *p = t.hi;
+    *s += t.lo + h.lo;
+}
+
+static inline void sum2_step(double *p, double *s, double a)
+{
+    ddouble t = two_sum(*p, a);
+    *p = t.hi;
+    *s += t.lo;
+}
+
+static ddouble accurate_combine(const double *p, const double *s)
+{
+    ddouble acc[DOT_ACC];
+    for (int k = 0; k != DOT_ACC; ++k)
+        acc[k] = two_sum(p[k], s[k]);
+    for (int w = DOT_ACC / 2; w != 0; w /= 2) {
+        for (int k = 0; k != w; ++k)
+            acc[k] = addqq(acc[k], acc[k + w]);
+    }
+    return acc[0];
+}
+
+static ddouble dot2d_block(const double *a, long sa, const double *b,
+                           long sb, long nn)
+{
+    double p[DOT_ACC] = {0}, s[DOT_ACC] = {0};
+    long i = 0;
+#ifdef DD_VEC_WIDTH
+    if (sa == 1 && sb == 1)
+        VEC_DOT2(vloadu1, vloadu1)
+    else
+        VEC_DOT2(vloadu_s, vloadu_s)
+#endif
+    for (; i + DOT_ACC <= nn; i += DOT_ACC) {
+        for (int k = 0; k != DOT_ACC; ++k)
+            dot2_step(&p[k], &s[k], a[(i + k) * sa], b[(i + k) * sb]);
+    }
+    for (int k = 0; i < nn; ++i, ++k)
+        dot2_step(&p[k], &s[k], a[i * sa], b[i * sb]);
+    return accurate_combine(p, s);
+}
+
+static ddouble dot2d_loop(const double *a, long sa, const double *b, long sb,
+                          long nn)
+{
+    if (nn <= REDUCE_BLOCK)
+        return dot2d_block(a, sa, b, sb, nn);
+    long half = nn / 2;
+    ddouble left = dot2d_loop(a, sa, b, sb, half);
+    return addqq(left, dot2d_loop(a + half * sa, sa, b + half * sb, sb,
+                                  nn - half));
+}
+
+static ddouble sum2d_block(const double *a, long sa, long nn)
+{
+    double p[DOT_ACC] = {0}, s[DOT_ACC] = {0};
+    long i = 0;
+#ifdef DD_VEC_WIDTH
+    if (sa == 1)
+        VEC_SUM2(vloadu1)
+    else
+        VEC_SUM2(vloadu_s)
+#endif
+    for (; i + DOT_ACC <= nn; i += DOT_ACC) {
+        for (int k = 0; k != DOT_ACC; ++k)
+            sum2_step(&p[k], &s[k], a[(i + k) * sa]);
+    }
+    for (int k = 0; i < nn; ++i, ++k)
+        sum2_step(&p[k], &s[k], a[i * sa]);
+    return accurate_combine(p, s);
+}
+
+static ddouble sum2d_loop(const double *a, long sa, long nn)
+{
+    if (nn <= REDUCE_BLOCK)
+        return sum2d_block(a, sa, nn);
+    long half = nn / 2;
+    ddouble left = sum2d_loop(a, sa, half);
+    return addqq(left, sum2d_loop(a + half * sa, sa, nn - half));
+}
+
+/* The matrix product follows the BLIS approach: the operands are copied
+ * ("packed") block by block into buffers, where each block fits into some
+ * level of the cache: KC x NC of B into the L3 cache and MC x KC of A into
+ * the L2 cache.  Within the packed blocks, a micro-kernel then updates a
+ * tile of MR x NR elements of C, which is kept in registers.
+ *
+ * Each element of C is still accumulated in order of j, starting from zero,
+ * so the result does not depend on the blocking or the instruction set.
+ */
+#ifdef DD_VEC_WIDTH
+#define GEMM_MR DD_VEC_WIDTH
+#define GEMM_NR 4
+#else
+#define GEMM_MR 2
+#define GEMM_NR 2
+#endif
+
+#define GEMM_MC 64
+#define GEMM_KC 256
+#define GEMM_NC 1024
+
+/* Minimum number of multiply-adds for which the product is parallelized */
+#define GEMM_PARALLEL 32768
+
+/* Products with fewer multiply-adds are not worth packing */
+#define GEMM_SMALL 512
+
+/* Pack `mc` x `kc` block of A into panels of MR rows, with `width` doubles
+ * for each j: for ddouble, the MR high parts followed by the MR low parts.
+ * Missing rows at the edge are zero.
+ */
+static inline void gemm_put_q(double *pa, long r, ddouble x)
+{
+    pa[r] = x.hi;
+    pa[GEMM_MR + r] = x.lo;
+}
+
+static inline void gemm_put_d(double *pa, long r, double x)
+{
+    pa[r] = x;
+}
+
+#define GEMM_PACK_A(name, type, width, put, zero)                       \
+    static void name(const type *a, long sai, long saj, long mc,        \
+                     long kc, double *pa)                               \
+    {                                                                   \
+        _Pragma("omp for")                                              \
+        for (long ir = 0; ir < mc; ir += GEMM_MR) {                     \
+            long mr = mc - ir < GEMM_MR ? mc - ir : GEMM_MR;            \
+            double *pa_r = pa + ir / GEMM_MR * (width) * kc;            \
+            for (long j = 0; j < kc; ++j, pa_r += (width)) {            \
+                long r = 0;                                             \
+                for (; r < mr; ++r)                                     \
+                    put(pa_r, r, a[(ir + r) * sai + j * saj]);          \
+                for (; r < GEMM_MR; ++r)                                \
+                    put(pa_r, r, zero);                                 \
+            }                                                           \
+        }                                                               \
+    }
+
+GEMM_PACK_A(gemm_pack_aq, ddouble, 2 * GEMM_MR, gemm_put_q, Q_ZERO)
+GEMM_PACK_A(gemm_pack_ad, double, GEMM_MR, gemm_put_d, 0.0)
+
+/* Pack `kc` x `nc` block of B into panels of NR columns, stored row by row.
+ * Missing columns at the edge are zero.
+ */
+#define GEMM_PACK_B(name, type, zero)                                   \
+    static void name(const type *b, long sbj, long sbk, long kc,        \
+                     long nc, type *pb)                                 \
+    {                                                                   \
+        _Pragma("omp for")                                              \
+        for (long kr = 0; kr < nc; kr += GEMM_NR) {                     \
+            long nr = nc - kr < GEMM_NR ? nc - kr : GEMM_NR;            \
+            type *pb_r = pb + kr * kc;                                  \
+            for (long j = 0; j < kc; ++j, pb_r += GEMM_NR) {            \
+                long r = 0;                                             \
+                for (; r < nr; ++r)                                     \
+                    pb_r[r] = b[j * sbj + (kr + r) * sbk];              \
+                for (; r < GEMM_NR; ++r)                                \
+                    pb_r[r] = zero;                                     \
+            }                                                           \
+        }                                                               \
+    }
+
+GEMM_PACK_B(gemm_pack_bq, ddouble, Q_ZERO)
+GEMM_PACK_B(gemm_pack_bd, double, 0.0)
+
+/* Loading packed elements of A and broadcasting elements of B */
+static inline ddouble gemm_get_q(const double *pa, int i)
+{
+    return (ddouble){pa[i], pa[GEMM_MR + i]};
+}
+
+static inline double gemm_get_d(const double *pa, int i)
+{
+    return pa[i];
+}
+
+#ifdef DD_VEC_WIDTH
+
+static inline vddouble gemm_vget_q(const double *pa)
+{
+    return (vddouble){vloadu(pa), vloadu(pa + GEMM_MR)};
+}
+
+static inline vdouble gemm_vget_d(const double *pa)
+{
+    return vloadu(pa);
+}
+
+static inline vddouble gemm_vbcast_q(ddouble b)
+{
+    return (vddouble){vset1(b.hi), vset1(b.lo)};
+}
+
+static inline vdouble gemm_vbcast_d(double b)
+{
+    return vset1(b);
+}
+
+/* Update the MR x NR tile `ct`, stored column by column with the high parts
+ * of each column followed by the low parts:
+ *
+ *      C[i, k] += sum_j A[i, j] * B[j, k]
+ */
+#define GEMM_MICRO(name, width, type_b, vget_a, vbcast_b, vmul, get_a, mul) \
+    static void name(long kc, const double *pa, const type_b *pb,       \
+                     double *ct)                                        \
+    {                                                                   \
+        vddouble c[GEMM_NR];                                            \
+        for (int k = 0; k != GEMM_NR; ++k) {                            \
+            c[k].hi = vloadu(ct + 2 * k * GEMM_MR);                     \
+            c[k].lo = vloadu(ct + (2 * k + 1) * GEMM_MR);               \
+        }                                                               \
+        for (long j = 0; j < kc; ++j, pa += (width), pb += GEMM_NR) {   \
+            for (int k = 0; k != GEMM_NR; ++k)                          \
+                c[k] = v_addqq(c[k], vmul(vget_a(pa), vbcast_b(pb[k]))); \
+        }                                                               \
+        for (int k = 0; k != GEMM_NR; ++k) {                            \
+            vstoreu(ct + 2 * k * GEMM_MR, c[k].hi);                     \
+            vstoreu(ct + (2 * k + 1) * GEMM_MR, c[k].lo);               \
+        }                                                               \
+    }
+
+#else
+
+#define GEMM_MICRO(name, width, type_b, vget_a, vbcast_b, vmul, get_a, mul) \
+    static void name(long kc, const double *pa, const type_b *pb,       \
+                     double *ct)                                        \
+    {                                                                   \
+        for (long j = 0; j < kc; ++j, pa += (width), pb += GEMM_NR) {   \
+            for (int k = 0; k != GEMM_NR; ++k) {                        \
+                double *ct_k = ct + 2 * k * GEMM_MR;                    \
+                for (int i = 0; i != GEMM_MR; ++i) {                    \
+                    ddouble c = {ct_k[i], ct_k[GEMM_MR + i]};           \
+                    c = addqq(c, mul(get_a(pa, i), pb[k]));             \
+                    ct_k[i] = c.hi;                                     \
+                    ct_k[GEMM_MR + i] = c.lo;                           \
+                }                                                       \
+            }                                                           \
+        }                                                               \
+    }
+
+#endif
+
+GEMM_MICRO(gemm_micro_qq, 2 * GEMM_MR, ddouble, gemm_vget_q, gemm_vbcast_q,
+           v_mulqq, gemm_get_q, mulqq)
+GEMM_MICRO(gemm_micro_dq, GEMM_MR, ddouble, gemm_vget_d, gemm_vbcast_q,
+           v_muldq, gemm_get_d, muldq)
+GEMM_MICRO(gemm_micro_qd, 2 * GEMM_MR, double, gemm_vget_q, gemm_vbcast_d,
+           v_mulqd, gemm_get_q, mulqd)
+
+/* Update the `mc` x `nc` block of C with the product of packed blocks */
+#define GEMM_MACRO(name, width, type_b, micro)                          \
+    static void name(long mc, long nc, long kc, const double *pa,       \
+                     const type_b *pb, ddouble *c, long sci, long sck)  \
+    {                                                                   \
+        _Pragma("omp for collapse(2)")                                  \
+        for (long kr = 0; kr < nc; kr += GEMM_NR) {                     \
+            for (long ir = 0; ir < mc; ir += GEMM_MR) {                 \
+                long nr = nc - kr < GEMM_NR ? nc - kr : GEMM_NR;        \
+                long mr = mc - ir < GEMM_MR ? mc - ir : GEMM_MR;        \
+                double ct[2 * GEMM_MR * GEMM_NR] = {0};                 \
+                double *ct_k = ct;                                      \
+                ddouble *c_r = c + ir * sci + kr * sck;                 \
+                                                                        \
+                for (long k = 0; k < nr; ++k, ct_k += 2 * GEMM_MR) {    \
+                    for (long i = 0; i < mr; ++i)                       \
+                        gemm_put_q(ct_k, i, c_r[i * sci + k * sck]);    \
+                }                                                       \
+                micro(kc, pa + ir / GEMM_MR * (width) * kc,             \
+                      pb + kr * kc, ct);                                \
+                ct_k = ct;                                              \
+                for (long k = 0; k < nr; ++k, ct_k += 2 * GEMM_MR) {    \
+                    for (long i = 0; i < mr; ++i)                       \
+                        c_r[i * sci + k * sck] = gemm_get_q(ct_k, i);   \
+                }                                                       \
+            }                                                           \
+        }                                                               \
+    }
+
+GEMM_MACRO(gemm_macro_qq, 2 * GEMM_MR, ddouble, gemm_micro_qq)
+GEMM_MACRO(gemm_macro_dq, GEMM_MR, ddouble, gemm_micro_dq)
+GEMM_MACRO(gemm_macro_qd, 2 * GEMM_MR, double, gemm_micro_qd)
+
+/* Defines `name`, which computes C = A @ B for `type_a` A and `type_b` B,
+ * using the packing and macro kernel functions given, or the plain loop
+ * with `mul` for small matrices.
+ */
+#define GEMM_KERNEL(name, type_a, type_b, width, pack_a, pack_b, macro, mul) \
+    static void name##_naive(const type_a *a, long sai, long saj,       \
+                             const type_b *b, long sbj, long sbk,       \
+                             ddouble *c, long sci, long sck,            \
+                             long ii, long jj, long kk)                 \
+    {                                                                   \
+        for (long i = 0; i < ii; ++i) {                                 \
+            for (long k = 0; k < kk; ++k) {                             \
+                ddouble val = Q_ZERO, tmp;                              \
+                for (long j = 0; j < jj; ++j) {                         \
+                    tmp = mul(a[i * sai + j * saj], b[j * sbj + k * sbk]); \
+                    val = addqq(val, tmp);                              \
+                }                                                       \
+                c[i * sci + k * sck] = val;                             \
+            }                                                           \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    static void name(const type_a *a, long sai, long saj,               \
+                     const type_b *b, long sbj, long sbk,               \
+                     ddouble *c, long sci, long sck,                    \
+                     long ii, long jj, long kk)                         \
+    {                                                                   \
+        if (ii * jj * kk < GEMM_SMALL) {                                \
+            name##_naive(a, sai, saj, b, sbj, sbk, c, sci, sck,         \
+                         ii, jj, kk);                                   \
+            return;                                                     \
+        }                                                               \
+                                                                        \
+        long mc_max = ii < GEMM_MC ? ii : GEMM_MC;                      \
+        long kc_max = jj < GEMM_KC ? jj : GEMM_KC;                      \
+        long nc_max = kk < GEMM_NC ? kk : GEMM_NC;                      \
+        mc_max = (mc_max + GEMM_MR - 1) / GEMM_MR * GEMM_MR;            \
+        nc_max = (nc_max + GEMM_NR - 1) / GEMM_NR * GEMM_NR;            \
+                                                                        \
+        double *pa = malloc(mc_max / GEMM_MR * (width) * kc_max         \
+                            * sizeof(double));                          \
+        type_b *pb = malloc(kc_max * nc_max * sizeof(type_b));          \
+        if (pa == NULL || pb == NULL) {                                 \
+            free(pa);                                                   \
+            free(pb);                                                   \
+            name##_naive(a, sai, saj, b, sbj, sbk, c, sci, sck,         \
+                         ii, jj, kk);                                   \
+            return;                                                     \
+        }                                                               \
+                                                                        \
+        _Pragma("omp parallel if(ii * jj * kk >= GEMM_PARALLEL)")       \
+        {                                                               \
+            _Pragma("omp for collapse(2)")                              \
+            for (long i = 0; i < ii; ++i) {                             \
+                for (long k = 0; k < kk; ++k)                           \
+                    c[i * sci + k * sck] = Q_ZERO;                      \
+            }                                                           \
+            for (long jc = 0; jc < kk; jc += GEMM_NC) {                 \
+                long nc = kk - jc < GEMM_NC ? kk - jc : GEMM_NC;        \
+                for (long pc = 0; pc < jj; pc += GEMM_KC) {             \
+                    long kc = jj - pc < GEMM_KC ? jj - pc : GEMM_KC;    \
+                    pack_b(b + pc * sbj + jc * sbk, sbj, sbk, kc, nc,   \
+                           pb);                                         \
+                    for (long ic = 0; ic < ii; ic += GEMM_MC) {         \
+                        long mc = ii - ic < GEMM_MC ? ii - ic : GEMM_MC; \
+                        pack_a(a + ic * sai + pc * saj, sai, saj, mc,   \
+                               kc, pa);                                 \
+                        macro(mc, nc, kc, pa, pb,                       \
+                              c + ic * sci + jc * sck, sci, sck);       \
+                    }                                                   \
+                }                                                       \
+            }                                                           \
+        }                                                               \
+        free(pa);                                                       \
+        free(pb);                                                       \
+    }
+
+GEMM_KERNEL(matmulq_gemm, ddouble, ddouble, 2 * GEMM_MR, gemm_pack_aq,
+            gemm_pack_bq, gemm_macro_qq, mulqq)
+GEMM_KERNEL(matmuldq_loop, double, ddouble, GEMM_MR, gemm_pack_ad,
+            gemm_pack_bq, gemm_macro_dq, muldq)
+GEMM_KERNEL(matmulqd_loop, ddouble, double, 2 * GEMM_MR, gemm_pack_aq,
+            gemm_pack_bd, gemm_macro_qd, mulqd)
+
+/* Matrix-vector products compute the dot product of each row of A with b,
+ * exactly like dotq_loop, so the result does not depend on the layout of
+ * A.  If A is stored column by column, the rows are processed in tiles of
+ * GEMV_TILE, where the accumulators of the dot products of all rows of the
+ * tile are vectorized over rows instead.  If `trans` is set, the factors
+ * are swapped, i.e., the dot products of b with each row of A are computed.
+ */
+#define GEMV_TILE 64
+
+static void gemv_cols_block(const ddouble *a, long saj, const ddouble *b,
+                            long sb, long nr, long nn, bool trans,
+                            ddouble *out)
+{
+    ddouble acc[DOT_ACC][GEMV_TILE];
+    for (int k = 0; k != DOT_ACC; ++k) {
+        for (long i = 0; i < nr; ++i)
+            acc[k][i] = Q_ZERO;
+    }
+    for (long j = 0; j < nn; ++j) {
+        ddouble *acc_j = acc[j % DOT_ACC];
+        const ddouble *a_j = a + j * saj;
+        ddouble b_j = b[j * sb];
+        long i = 0;
+#ifdef DD_VEC_WIDTH
+        vddouble vb_j = {vset1(b_j.hi), vset1(b_j.lo)};
+        for (; i + DD_VEC_WIDTH <= nr; i += DD_VEC_WIDTH) {
+            vddouble va = vload_q(a_j + i);
+            vddouble p = trans ? v_mulqq(vb_j, va) : v_mulqq(va, vb_j);
+            vstore_q(acc_j + i, v_addqq(vload_q(acc_j + i), p));
+        }
+#endif
+        for (; i < nr; ++i) {
+            ddouble p = trans ? mulqq(b_j, a_j[i]) : mulqq(a_j[i], b_j);
+            acc_j[i] = addqq(acc_j[i], p);
+        }
+    }
+    for (int w = DOT_ACC / 2; w != 0; w /= 2) {
+        for (int k = 0; k != w; ++k)
+            addqq_vec(acc[k], acc[k + w], acc[k], nr);
+    }
+    for (long i = 0; i < nr; ++i)
+        out[i] = acc[0][i];
+}
+
+static void gemv_cols(const ddouble *a, long saj, const ddouble *b, long sb,
+                      long nr, long nn, bool trans, ddouble *out)
+{
+    if (nn <= REDUCE_BLOCK) {
+        gemv_cols_block(a, saj, b, sb, nr, nn, trans, out);
+        return;
+    }
+    long half = nn / 2;
+    ddouble right[GEMV_TILE];
+    gemv_cols(a, saj, b, sb, nr, half, trans, out);
+    gemv_cols(a + half * saj, saj, b + half * sb, sb, nr, nn - half, trans,
+              right);
+    addqq_vec(out, right, out, nr);
+}
+
+static void gemvq(const ddouble *a, long sai, long saj, const ddouble *b,
+                  long sb, ddouble *c, long sc, long ii, long jj, bool trans)
+{
+    if (sai == 1 && saj != 1) {
+        #pragma omp parallel for if(ii * jj >= GEMM_PARALLEL)
+        for (long it = 0; it < ii; it += GEMV_TILE) {
+            long nr = ii - it < GEMV_TILE ? ii - it : GEMV_TILE;
+            ddouble out[GEMV_TILE];
+            gemv_cols(a + it, saj, b, sb, nr, jj, trans, out);
+            for (long i = 0; i < nr; ++i)
+                c[(it + i) * sc] = out[i];
+        }
+    } else {
+        #pragma omp parallel for if(ii * jj >= GEMM_PARALLEL)
+        for (long i = 0; i < ii; ++i) {
+            c[i * sc] = trans ? dotq_loop(b, sb, a + i * sai, saj, jj)
+                              : dotq_loop(a + i * sai, saj, b, sb, jj);
+        }
+    }
+}
+
+static void matmulq_loop(const ddouble *a, long sai, long saj,
+                         const ddouble *b, long sbj, long sbk,
+                         ddouble *c, long sci, long sck,
+                         long ii, long jj, long kk)
+{
+    if (kk == 1)
+        gemvq(a, sai, saj, b, sbj, c, sci, ii, jj, false);
+    else if (ii == 1)
+        gemvq(b, sbk, sbj, a, saj, c, sck, kk, jj, true);
+    else
+        matmulq_gemm(a, sai, saj, b, sbj, sbk, c, sci, sck, ii, jj, kk);
+}
+
+/* Rank-one updates are vectorized along a row (or column) of A if it is
+ * contiguous together with w (or v).  If `trans` is set, the factors are
+ * swapped, so either way each element is updated as a[i,j] += v[i] * w[j].
+ */
+static void rank1_row(ddouble *a, ddouble x, const ddouble *y, long nn,
+                      bool trans)
+{
+    long k = 0;
+#ifdef DD_VEC_WIDTH
+    vddouble vx = {vset1(x.hi), vset1(x.lo)};
+    for (; k + DD_VEC_WIDTH <= nn; k += DD_VEC_WIDTH) {
+        vddouble vy = vload_q(y + k);
+        vddouble p = trans ? v_mulqq(vy, vx) : v_mulqq(vx, vy);
+        vstore_q(a + k, v_addqq(vload_q(a + k), p));
+    }
+#endif
+    for (; k < nn; ++k)
+        a[k] = addqq(a[k], trans ? mulqq(y[k], x) : mulqq(x, y[k]));
+}
+
+static void rank1updateq_loop(ddouble *a, long sai, long saj,
+                              const ddouble *v, long sv,
+                              const ddouble *w, long sw, long ii, long jj)
+{
+    if (saj == 1 && sw == 1) {
+        #pragma omp parallel for if(ii * jj >= GEMM_PARALLEL)
+        for (long i = 0; i < ii; ++i)
+            rank1_row(a + i * sai, v[i * sv], w, jj, false);
+    } else if (sai == 1 && sv == 1) {
+        #pragma omp parallel for if(ii * jj >= GEMM_PARALLEL)
+        for (long j = 0; j < jj; ++j)
+            rank1_row(a + j * saj, w[j * sw], v, ii, true);
+    } else {
+        #pragma omp parallel for collapse(2) if(ii * jj >= GEMM_PARALLEL)
+        for (long i = 0; i < ii; ++i) {
+            for (long j = 0; j < jj; ++j) {
+                ddouble *aij = a + i * sai + j * saj;
+                *aij = addqq(*aij, mulqq(v[i * sv], w[j * sw]));
+            }
+        }
+    }
+}
+
+static void rotq_loop(ddouble *x, long sx, ddouble *y, long sy, ddouble c,
+                      ddouble s, long nn)
+{
+    long i = 0;
+#ifdef DD_VEC_WIDTH
+    if (sx == 1 && sy == 1) {
+        vddouble vc = {vset1(c.hi), vset1(c.lo)};
+        vddouble vs = {vset1(s.hi), vset1(s.lo)};
+        for (; i + DD_VEC_WIDTH <= nn; i += DD_VEC_WIDTH) {
+            vddouble vx = vload_q(x + i), vy = vload_q(y + i);
+            vstore_q(x + i, v_addqq(v_mulqq(vc, vx), v_mulqq(vs, vy)));
+            vstore_q(y + i, v_subqq(v_mulqq(vc, vy), v_mulqq(vs, vx)));
+        }
+    }
+#endif
+    for (; i < nn; ++i) {
+        ddouble xi = x[i * sx], yi = y[i * sy];
+        x[i * sx] = addqq(mulqq(c, xi), mulqq(s, yi));
+        y[i * sy] = subqq(mulqq(c, yi), mulqq(s, xi));
+    }
+}
+
+const ddkernels dd_kernels = {
+    .name = DD_ISA_STRING,
+    .addqq = addqq_vec,
+    .subqq = subqq_vec,
+    .mulqq = mulqq_vec,
+    .divqq = divqq_vec,
+    .addqd = addqd_vec,
+    .subqd = subqd_vec,
+    .mulqd = mulqd_vec,
+    .divqd = divqd_vec,
+    .adddq = adddq_vec,
+    .subdq = subdq_vec,
+    .muldq = muldq_vec,
+    .divdq = divdq_vec,
+    .sqrt = sqrtq_loop,
+    .exp = expq_loop,
+    .expm1 = expm1q_loop,
+    .log = logq_loop,
+    .log2 = log2q_loop,
+    .log10 = log10q_loop,
+    .log1p = log1pq_loop,
+    .sin = sinq_loop,
+    .cos = cosq_loop,
+    .sincos = sincosq_loop,
+    .sinh = sinhq_loop,
+    .cosh = coshq_loop,
+    .tanh = tanhq_loop,
+    .sum = sumq_loop,
+    .prod = prodq_loop,
+    .sumd = sumd_loop,
+    .dot = dotq_loop,
+    .dot2 = dot2d_loop,
+    .sum2 = sum2d_loop,
+    .matmul = matmulq_loop,
+    .matmuldq = matmuldq_loop,
+    .matmulqd = matmulqd_loop,
+    .rank1update = rank1updateq_loop,
+    .rot = rotq_loop
+    };
+
+/* ---------------------------- Dispatch ---------------------------- */
+
+#ifndef DD_ISA
+
+static bool cpu_supports(const char *name)
+{
+    if (strcmp(name, "baseline") == 0)
+        return true;
+#if (defined(__GNUC__) || defined(__clang__)) \
+        && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (strcmp(name, "avx2") == 0)
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (strcmp(name, "avx512") == 0)
+        return __builtin_cpu_supports("avx512f")
+               && __builtin_cpu_supports("avx2")
+               && __builtin_cpu_supports("fma");
+#endif
+    return false;
+}
+
+const ddkernels *dd_select_kernels(void)
+{
+    /* In order of preference */
+    static const ddkernels *variants[] = {
+#ifdef DD_DISPATCH_AVX512
+        &dd_kernels_avx512,
+#endif
+#ifdef DD_DISPATCH_AVX2
+        &dd_kernels_avx2,
+#endif
+        &dd_kernels
+        };
+    const int nvariants = sizeof(variants) / sizeof(*variants);
+    const char *requested = getenv("XPREC_DISPATCH");
+    if (requested != NULL && requested[0] == '\0')
+        requested = NULL;
+
+    for (int i = 0; i != nvariants; ++i) {
+        if (requested != NULL && strcmp(requested, variants[i]->name) != 0)
+            continue;
+        if (cpu_supports(variants[i]->name))
+            return variants[i];
+    }
+    return &dd_kernels;
+}
+
+#endif /* DD_ISA */
@@ -0,0 +1,140 @@
+/* Vectorized double-double kernels, dispatched by instruction set.
+ *
+ * Copyright (C) 2021 Markus Wallerberger and others
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include "dd_arith.h"
+#include "dd_dispatch.h"
+
+typedef void (*ddkernel_qq)(const ddouble *a, const ddouble *b, ddouble *c,
+                            long nn);
+typedef void (*ddkernel_qd)(const ddouble *a, const double *b, ddouble *c,
+                            long nn);
+typedef void (*ddkernel_dq)(const double *a, const ddouble *b, ddouble *c,
+                            long nn);
+typedef void (*ddkernel_unary)(const ddouble *a, long sa, ddouble *b, long sb,
+                               long nn);
+typedef ddouble (*ddkernel_reduce)(const ddouble *a, long sa, long nn);
+typedef void (*ddkernel_unary2)(const ddouble *a, long sa, ddouble *b, long sb,
+                                ddouble *c, long sc, long nn);
+
+/**
+ * Table of hot kernels compiled for a specific instruction set.
+ *
+ * For each instruction set variant the extension is compiled for, there is
+ * one such table.  Use `dd_select_kernels()` to get the best one for the
+ * current CPU.
+ */
+typedef struct {
+    /** Name of instruction set variant */
+    const char *name;
+
+    /**
+     * Elementwise arithmetic on contiguous arrays of length `nn`:
+     *
+     *      c[i] = a[i] OP b[i]
+     *
+     * The result is bitwise identical to calling the corresponding scalar
+     * function from `dd_arith.h` on each element, but several elements are
+     * processed at once if the instruction set allows for it.  `c` may alias
+     * `a` or `b`.
+     */
+    ddkernel_qq addqq, subqq, mulqq, divqq;
+    ddkernel_qd addqd, subqd, mulqd, divqd;
+    ddkernel_dq adddq, subdq, muldq, divdq;
+
+    /**
+     * Elementwise functions on strided arrays: b[i * sb] = f(a[i * sa]).
+     * Members are named after the numpy ufuncs (the names of the scalar
+     * functions are macros, see dd_arith.h).
+     */
+    ddkernel_unary sqrt, exp, expm1, log, log2, log10, log1p, sin, cos, sinh,
+                   cosh, tanh;
+
+    /** Sine and cosine at once: b[i * sb], c[i * sc] = sincos(a[i * sa]) */
+    ddkernel_unary2 sincos;
+
+    /**
+     * Sum and product of the elements of a strided vector of length `nn`.
+     * These use several accumulators, so the result differs from summing
+     * the elements in order, but not between instruction sets.
+     */
+    ddkernel_reduce sum, prod;
+
+    /** Sum of a strided double vector, accumulated in ddouble like `sum` */
+    ddouble (*sumd)(const double *a, long sa, long nn);
+
+    /**
+     * Dot product of two strided vectors of length `nn`.  Like `sum`, this
+     * uses several accumulators, and the result does not depend on the
+     * instruction set.
+     */
+    ddouble (*dot)(const ddouble *a, long sa, const ddouble *b, long sb,
+                   long nn);
+
+    /**
+     * Accurate dot product and sum of strided double vectors (Dot2 and Sum2
+     * of Ogita, Rump and Oishi).  The result is as accurate as if computed
+     * in twice the working precision and does not depend on the instruction
+     * set.
+     */
+    ddouble (*dot2)(const double *a, long sa, const double *b, long sb,
+                    long nn);
+    ddouble (*sum2)(const double *a, long sa, long nn);
+
+    /**
+     * Matrix product of a `ii` times `jj` with a `jj` times `kk` matrix:
+     *
+     *      C[i, k] = sum_j A[i, j] * B[j, k]
+     *
+     * If `kk` (or `ii`) is one, each element of C is computed like `dot`
+     * of a row of A with B (or of A with a column of B).
+     */
+    void (*matmul)(const ddouble *a, long sai, long saj,
+                   const ddouble *b, long sbj, long sbk,
+                   ddouble *c, long sci, long sck, long ii, long jj, long kk);
+
+    /** Matrix product where A or B, respectively, is a double matrix */
+    void (*matmuldq)(const double *a, long sai, long saj,
+                     const ddouble *b, long sbj, long sbk,
+                     ddouble *c, long sci, long sck, long ii, long jj, long kk);
+    void (*matmulqd)(const ddouble *a, long sai, long saj,
+                     const double *b, long sbj, long sbk,
+                     ddouble *c, long sci, long sck, long ii, long jj, long kk);
+
+    /**
+     * Rank-one update of a `ii` times `jj` matrix: A[i, j] += v[i] * w[j].
+     * Each element is updated like the scalar functions would do it.
+     */
+    void (*rank1update)(ddouble *a, long sai, long saj,
+                        const ddouble *v, long sv, const ddouble *w, long sw,
+                        long ii, long jj);
+
+    /**
+     * Apply a Givens rotation to two strided vectors, like `lmul_givensq`
+     * from dd_linalg.h for each pair (x[i * sx], y[i * sy]).
+     */
+    void (*rot)(ddouble *x, long sx, ddouble *y, long sy, ddouble c,
+                ddouble s, long nn);
+} ddkernels;
+
+#define dd_kernels DD_ISA_NAME(dd_kernels)
+
+extern const ddkernels dd_kernels;
+
+#ifdef DD_DISPATCH_AVX2
+extern const ddkernels dd_kernels_avx2;
+#endif
+#ifdef DD_DISPATCH_AVX512
+extern const ddkernels dd_kernels_avx512;
+#endif
+
+/**
+ * Return the kernels for the most capable instruction set supported by both
+ * the build and the CPU.
+ *
+ * The choice can be restricted by setting the environment variable
+ * `XPREC_DISPATCH` to the name of a variant, e.g., "baseline" or "avx2".
+ */
+const ddkernels *dd_select_kernels(void);
@@ -25,6 +25,42 @@ from . import _dd_linalg    # needed for matmul
 
 ddouble = _dd_ufunc.dtype
 
+# Sine and cosine of a ddouble array, computed together
+sincos = _dd_ufunc.sincos
+
+# Name of the instruction set variant of the kernels used on this CPU
+dispatch_variant = _dd_ufunc.dispatch_variant
+
+# Minimum work per thread for elementwise operations, in units of the cost
+# of one ddouble addition.  Smaller arrays are processed serially.
+get_grain_size = _dd_ufunc.get_grain_size
+set_grain_size = _dd_ufunc.set_grain_size
+
+# If set, sums, dot products and norms are computed in a fixed order that
+# does not depend on the number of threads, at a small cost in throughput.
+get_deterministic = _dd_ufunc.get_deterministic
+set_deterministic = _dd_ufunc.set_deterministic
+
+
+def dot2(a, b):
+    """Accurate dot product of float64 vectors, returned as ddouble.
+
+    Uses the Dot2 algorithm of Ogita, Rump and Oishi on the double inputs,
+    so the result is as accurate as if computed in twice the working
+    precision, but the inputs are never converted to ddouble.  Leading axes
+    are broadcast as for a gufunc with signature `(i),(i)->()`.
+    """
+    return _dd_ufunc.dot2(a, b).view(ddouble)[..., 0][()]
+
+
+def sum2(x):
+    """Accurate sum of a float64 vector, returned as ddouble.
+
+    Uses the Sum2 algorithm of Ogita, Rump and Oishi, see `dot2`.  Sums over
+    the last axis.
+    """
+    return _dd_ufunc.sum2(x).view(ddouble)[..., 0][()]
+
 
 def finfo(dtype):
     dtype = _np.dtype(dtype)
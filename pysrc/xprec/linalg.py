@@ -15,6 +15,108 @@ householder = _dd_linalg.householder
 rank1update = _dd_linalg.rank1update
 
 
+def matmul(A, B, method=None):
+    """Matrix product of two arrays.
+
+    Computes `A @ B`, following the broadcasting rules of `numpy.matmul`.
+    `method` selects the algorithm:
+
+      - `None`: the native ddouble kernel, same as `A @ B`.
+
+      - `"ozaki"`: the Ozaki scheme.  Both operands are split into float64
+        slices, such that the products of slices are computed exactly by
+        the BLAS library numpy is linked to.  These products are then summed
+        in ddouble.  The error is comparable to the one of the native
+        kernel, i.e., small compared to `abs(A) @ abs(B)`.  For large
+        matrices, this costs about ten float64 products and is thus
+        faster if BLAS is more than ten times faster than the native
+        kernel, e.g., with many cores.  All elements must be finite.
+    """
+    if method is None:
+        return np.matmul(A, B)
+    elif method == "ozaki":
+        return _matmul_ozaki(A, B)
+    else:
+        raise ValueError("invalid method")
+
+
+def _matmul_ozaki(A, B):
+    A = np.asarray(A, ddouble)
+    B = np.asarray(B, ddouble)
+    if A.ndim == 0 or B.ndim == 0:
+        raise ValueError("matmul: operands must not be scalars")
+    if A.ndim == 1:
+        return _matmul_ozaki(A[None, :], B)[..., 0, :]
+    if B.ndim == 1:
+        return _matmul_ozaki(A, B[:, None])[..., 0]
+
+    k = A.shape[-1]
+    if B.shape[-2] != k:
+        raise ValueError("matmul: mismatch in inner dimension")
+
+    # Slices hold integer multiples of 2**-beta times a power of two per row
+    # of A or column of B, of magnitude at most 2**beta, so the sum of `k`
+    # products of them fits into the 53 bits of a double.  The products of
+    # slices are summed exactly up to an order of nslices * beta bits, which
+    # leaves terms small enough to be computed in double precision.
+    log2k = int(np.ceil(np.log2(max(k, 2))))
+    beta = (53 - log2k) // 2
+    nslices = -(-(53 + log2k) // beta)
+    a_slices, a_tails, a_exp = _ozaki_split(A, -1, beta, nslices)
+    b_slices, b_tails, b_exp = _ozaki_split(B, -2, beta, nslices)
+
+    C = a_tails[nslices] @ b_tails[0]
+    for s in range(nslices):
+        C += a_slices[s] @ b_tails[nslices - s]
+    C = C.astype(ddouble)
+    for d in range(nslices - 1, -1, -1):
+        for s in range(d + 1):
+            C += a_slices[s] @ b_slices[d - s]
+
+    # Undo the scaling
+    C_parts = C.view(np.float64).reshape(C.shape + (2,))
+    C_parts[...] = np.ldexp(C_parts, (a_exp + b_exp)[..., None])
+    return C
+
+
+def _ozaki_split(X, axis, beta, nslices):
+    """Split ddouble array into float64 slices for the Ozaki scheme.
+
+    Returns `slices, tails, exp`, where `sum(slices) + tails[-1]` is `X`
+    scaled by `2**-exp`, where `exp` is a power of two for each slice along
+    `axis`, and `tails[s]` approximates `X - sum(slices[:s])` in double.
+    """
+    X = np.ascontiguousarray(X)
+    X_parts = X.view(np.float64).reshape(X.shape + (2,))
+    hi = X_parts[..., 0]
+    lo = X_parts[..., 1]
+
+    # Scaling by powers of two is exact and avoids overflow below
+    _, exp = np.frexp(np.abs(hi).max(axis, keepdims=True))
+    hi = np.ldexp(hi, -exp)
+    lo = np.ldexp(lo, -exp)
+
+    slices = []
+    tails = [hi]
+    for _ in range(nslices):
+        # Adding and subtracting shift rounds hi to a multiple of
+        # 2**(e - beta), where 2**e bounds hi along the axis.
+        _, e = np.frexp(np.abs(hi).max(axis, keepdims=True))
+        shift = np.ldexp(0.75, e + 53 - beta)
+        head = (shift + hi) - shift
+        hi, lo = _two_sum(hi - head, lo)
+        slices.append(head)
+        tails.append(hi)
+    return slices, tails, exp
+
+
+def _two_sum(a, b):
+    """Error-free sum of two float64 arrays, see `two_sum` in dd_arith.h"""
+    s = a + b
+    v = s - a
+    return s, (a - (s - v)) + (b - v)
+
+
 def qr(A, reflectors=False):
     """QR decomposition without pivoting.
 
@@ -24,17 +126,20 @@ def qr(A, reflectors=False):
 
     where `Q` is an `(m, m)` orthogonal matrix and `R` is a `(m, n)` upper
     triangular matrix.  No pivoting is used.
+
+    If `reflectors` is true, `Q` is instead returned as `(m, k)` matrix of
+    Householder reflectors, where `k = min(m, n)`, as used by
+    `householder_apply`.
     """
-    R = np.array(A)
+    R, tau = _dd_linalg.householder_qr(A)
     m, n = R.shape
     k = min(m, n)
 
-    Q = np.zeros((k, m), A.dtype)
-    for i in range(k):
-        householder_update(R[i:,i:], Q[i:,i:])
+    Q = np.tril(R[:,:k], -1)
+    Q[np.diag_indices(k)] = tau[:k]
+    R = np.triu(R)
     if not reflectors:
-        I = np.eye(m, dtype=A.dtype)
-        Q = householder_apply(Q, I)
+        Q = householder_q(Q)
     return Q, R
 
 
@@ -49,53 +154,76 @@ def rrqr(A, tol=5e-32, reflectors=False):
     triangular matrix, `piv` is a permutation vector, and `k` is chosen such
     that the relative tolerance `tol` is met in the equality above.
     """
-    R = np.array(A)
-    m, n = R.shape
-    k = min(m, n)
-
-    Q = np.zeros((m, k), A.dtype)
-    jpvt = np.arange(n)
-    norms = norm(A.T)
-    xnorms = norms.copy()
-    TOL3Z = np.finfo(float).eps
-    for i in range(k):
-        pvt = i + np.argmax(norms[i:])
-        if i != pvt:
-            R[:,[i, pvt]] = R[:,[pvt, i]]
-            jpvt[[i, pvt]] = jpvt[[pvt, i]]
-            norms[pvt] = norms[i]
-            xnorms[pvt] = xnorms[i]
-
-        householder_update(R[i:,i:], Q[i:,i:])
-
-        js = (i + 1) + norms[i + 1:].nonzero()[0]
-        temp = np.abs(R[i,js]) / norms[js]
-        temp = np.fmax(0.0, (1 + temp)*(1 - temp))
-        temp2 = temp * np.square(norms[js] / xnorms[js])
-
-        wheresmall = temp2 < TOL3Z
-        jsmall = js[wheresmall]
-        upd_norms = norm(R[i+1:,jsmall].T)
-        norms[jsmall] = upd_norms
-        xnorms[jsmall] = upd_norms
-        jbig = js[~wheresmall]
-        norms[jbig] *= np.sqrt(temp[~wheresmall])
-
-        if tol is not None:
-            acc = np.abs(R[i,i] / R[0,0])
-            if acc < tol:
-                k = i + 1
-                Q = Q[:,:k]
-                R = R[:k,:]
-                break
-
+    R, tau, jpvt, k = _dd_linalg.householder_rrqr(A, 0 if tol is None else tol)
+    k = int(k)
+    if k < 0:
+        raise MemoryError()
+
+    Q = np.tril(R[:,:k], -1)
+    Q[np.diag_indices(k)] = tau[:k]
+    R = np.triu(R[:k,:])
     if not reflectors:
-        I = np.eye(m, k, dtype=A.dtype)
-        Q = householder_apply(Q, I)
+        Q = householder_q(Q, k)
     return Q, R, jpvt
 
 
-def svd(A, full_matrices=True):
+def solve(A, b, max_iter=10, method=None):
+    """Solve a linear system `A @ x == b` for a square matrix `A`.
+
+    `b` may be a vector or a matrix with one right-hand side per column.  The
+    system is first solved in double precision by LAPACK and the solution is
+    then refined iteratively, where the residuals are computed in ddouble
+    precision.  Each step gains about as many digits as are lost to the
+    condition number of `A` in double precision, so this only needs a few
+    ddouble matrix-vector products for well-conditioned systems.  Should the
+    refinement stall, e.g., for ill-conditioned `A`, the system is instead
+    solved by ddouble LU decomposition with partial pivoting.
+
+    `method` selects the algorithm for the residuals, see `matmul`.
+    """
+    A = np.asarray(A, ddouble)
+    b = np.asarray(b, ddouble)
+    n, n_ = A.shape
+    if n != n_:
+        raise ValueError("A must be square")
+    if b.ndim == 1:
+        return solve(A, b[:, None], max_iter, method)[:, 0]
+
+    # numpy exposes LAPACK's LU decomposition only through inv() and solve(),
+    # so we apply the inverse, which costs the same per step
+    try:
+        with np.errstate(all='ignore'):
+            Ainv = np.linalg.inv(A.astype(float))
+        x = (Ainv @ b.astype(float)).astype(ddouble)
+        ok = np.isfinite(Ainv).all() and np.isfinite(x).all()
+    except np.linalg.LinAlgError:
+        ok = False
+
+    # Stop once the residual is of the order of the rounding errors of b - A x
+    # (the criterion of LAPACK's dsgesv), but give up if it does not decrease
+    # considerably in each step.
+    thresh = 5e-32 * np.sqrt(n) * float(np.abs(A).sum(1).max())
+    rnorm_prev = np.inf
+    for _ in range(max_iter if ok else 0):
+        r = b - matmul(A, x, method)
+        rnorm = np.abs(r).max(0)
+        if (rnorm <= thresh * np.abs(x).max(0)).all():
+            return x
+        rnorm = float(rnorm.max())
+        if not rnorm < rnorm_prev / 2:
+            break
+        rnorm_prev = rnorm
+        x = x + Ainv @ r.astype(float)
+
+    x, info = _dd_linalg.lu_solve(A, b)
+    if info < 0:
+        raise MemoryError()
+    if info > 0:
+        raise np.linalg.LinAlgError("Singular matrix")
+    return x
+
+
+def svd(A, full_matrices=True, method='golub-kahan'):
     """Truncated singular value decomposition.
 
     Decomposes a `(m, n)` matrix `A` into the product:
@@ -105,26 +233,119 @@ def svd(A, full_matrices=True):
     where `U` is a `(m, k)` matrix with orthogonal columns, `VT` is a `(k, n)`
     matrix with orthogonal rows and `s` are the singular values, a set of `k`
     nonnegative numbers in non-ascending order and `k = min(m, n)`.
+
+    After reduction to bidiagonal form, the SVD of the bidiagonal matrix is
+    computed by implicit QR steps (`method="golub-kahan"`) or by divide and
+    conquer (`method="dc"`), which is faster for large matrices.
     """
     A = np.asarray(A)
     m, n = A.shape
     if m < n:
-        U, s, VT = svd(A.T, full_matrices)
+        U, s, VT = svd(A.T, full_matrices, method)
         return VT.T, s, U.T
 
     Q, B, RT = bidiag(A)
-    for _ in range(20 * n):
-        if svd_bidiag_step(Q, B, RT):
-            break
+    d = B.diagonal().copy()
+    e = np.hstack([B.diagonal(1), 0.0])
+    if method == 'golub-kahan':
+        # Rotations act on pairs of columns of U, which should be contiguous
+        U = np.asfortranarray(Q[:,:n])
+        _, _, _, info = _dd_linalg.svd_bidiag(d, e, U, RT,
+                                              out=(d, U, RT, None))
+    elif method == 'dc':
+        d, UB, VTB, info = _dd_linalg.svd_bidiag_dc(d, e)
+        U = Q[:,:n] @ UB
+        RT = VTB @ RT
     else:
+        raise ValueError("invalid method")
+    if info < 0:
+        raise MemoryError()
+    if info > 0:
         warn("Did not converge")
+    Q[:,:n] = U
 
-    U, s, VH = svd_normalize(Q, B.diagonal(), RT)
+    U, s, VH = svd_normalize(Q, d, RT)
     if not full_matrices:
         U = U[:,:n]
     return U, s, VH
 
 
+def svd_refine(A, max_iter=5, method=None):
+    """Singular value decomposition refined from a double precision one.
+
+    Returns `U, s, VT` like `svd(A, full_matrices=False)`.  The SVD is first
+    computed in double precision by LAPACK and then refined by the iteration
+    of Ogita and Aishima, which only needs a few ddouble matrix products per
+    step and converges quadratically.  Singular values closer than about
+    `1e-8` relative to the largest one are treated as a cluster, where the
+    singular vectors are found by `svd` of a small matrix.  This is much
+    faster than `svd` for large matrices, but requires `A` to have full rank
+    and to be well-conditioned enough for the double precision SVD to be
+    accurate to a few digits.
+
+    `method` selects the algorithm for the matrix products, see `matmul`.
+    """
+    A = np.asarray(A, ddouble)
+    m, n = A.shape
+    if m < n:
+        U, s, VT = svd_refine(A.T, max_iter, method)
+        return VT.T, s, U.T
+
+    U, _, VT = np.linalg.svd(A.astype(float), full_matrices=False)
+    U = U.astype(ddouble)
+    V = VT.T.astype(ddouble)
+    eye = np.eye(n)
+    for _ in range(max_iter):
+        # Write the exact SVD as U (I + F), V (I + G).  To first order, the
+        # symmetric parts of F and G are given by the loss of orthogonality
+        # R and S, and the rest by requiring that U.T A V becomes diagonal.
+        AV = matmul(A, V, method)
+        T = matmul(U.T, AV, method)
+        R = eye - matmul(U.T, U, method)
+        S = eye - matmul(V.T, V, method)
+        s = T.diagonal() / (1 - (R.diagonal() + S.diagonal()) / 2)
+
+        # For close singular values, the equations for F and G are (nearly)
+        # singular.  Such clusters are only orthogonalized here and then
+        # diagonalized by a small ddouble SVD.
+        T_off = T - np.diag(T.diagonal())
+        err = float(np.linalg.norm(R) + np.linalg.norm(S)
+                    + np.linalg.norm(T_off) / s[0])
+        thresh = max(2 * err, 1e-8) * s[0]
+        cluster = np.hstack([0, np.cumsum(s[:-1] - s[1:] > thresh)])
+        close = cluster[:, None] == cluster[None, :]
+        s_i = s[:, None]
+        s_j = s[None, :]
+        den = np.where(close, 1, (s_j - s_i) * (s_j + s_i))
+        a = -T
+        b = T.T + s_i * R + S * s_j
+        F = np.where(close, R / 2, (s_j * a - s_i * b) / den).T
+        G = np.where(close, S / 2, (s_j * b - s_i * a) / den)
+
+        # Of the part of U (I + F) orthogonal to U, only the projection
+        # (1 - U U.T) (A V / s - U) is needed.
+        W = AV / s - U
+        U = U + matmul(U, F - matmul(U.T, W, method), method) + W
+        V = V + matmul(V, G, method)
+        for c in range(cluster[-1] + 1):
+            idx = np.flatnonzero(cluster == c)
+            if idx.size > 1:
+                X, s[idx], YT = svd(U[:, idx].T @ (A @ V[:, idx]))
+                U[:, idx] = U[:, idx] @ X
+                V[:, idx] = V[:, idx] @ YT.T
+
+        # The remaining error is of order n delta**2 divided by the relative
+        # gap between the clusters.
+        delta = float(max(np.abs(F).max(), np.abs(G).max()))
+        gap = np.abs(s_j - s_i)
+        rgap = float(np.where(close, s[0], gap).min() / s[0])
+        if n * delta**2 <= 5e-32 * rgap:
+            break
+    else:
+        warn("Did not converge")
+    return U, s, V.T
+
+
 def svd_trunc(A, tol=5e-32, method='jacobi', max_iter=20):
     """Truncated singular value decomposition.
 
@@ -189,14 +410,20 @@ def bidiag(A, reflectors=False, force_structure=False):
         B[i, i] = d
         B[i[:-1], i[:-1]+1] = e
     if not reflectors:
-        Q = householder_apply(Q, np.eye(m, dtype=B.dtype))
-        R = householder_apply(R, np.eye(n, dtype=B.dtype))
+        Q = householder_q(Q)
+        R = householder_q(R)
     return Q, B, R.T
 
 
-def svd_jacobi(A, tol=5e-32, max_iter=20):
-    """Singular value decomposition using Jacobi rotations."""
-    U = A.copy()
+def svd_jacobi(A, tol=5e-32, max_iter=20, block=1):
+    """Singular value decomposition using Jacobi rotations.
+
+    If `block` is larger than one, the columns are orthogonalized in blocks
+    of that size, which works on small Gram matrices in cache and updates
+    `A` with matrix products.
+    """
+    # Pairs of columns are rotated, so keep the columns contiguous
+    U = np.array(A, order='F')
     m, n = U.shape
     if m < n:
         raise RuntimeError("expecting tall matrix")
@@ -206,7 +433,7 @@ def svd_jacobi(A, tol=5e-32, max_iter=20):
 
     limit = tol * np.linalg.norm(U[:n,:n], 'fro')
     for _ in range(max_iter):
-        _dd_linalg.jacobi_sweep(U, VT, out=(U, VT, offd))
+        _dd_linalg.jacobi_sweep(U, VT, block, out=(U, VT, offd))
         if offd <= limit:
             break
     else:
@@ -226,26 +453,35 @@ def householder_update(A, Q):
     Q[1:,0] = v[1:]
 
 
-def householder_apply(H, Q):
-    """Applies a set of reflectors to a matrix"""
+def householder_apply(H, Q, trans=False):
+    """Applies a set of reflectors to a matrix.
+
+    Returns `H[0] @ H[1] @ ... @ H[r-1] @ Q`, or `(H[0] @ ... @ H[r-1]).T @ Q`
+    if `trans` is true, for an arbitrary `(m, n)` matrix `Q`.  Each reflector
+    `H[j] = I - tau * v @ v.T` is stored in column `j` of the `(m, r)` matrix
+    `H`, with `tau` on the diagonal and `v[1:]` below it (`v[0] = 1`), as
+    returned by `qr(..., reflectors=True)`.  The reflectors are applied in
+    blocks using matrix products.
+    """
     H = np.asarray(H)
-    Q = Q.copy()
-    m, r = H.shape
-    if Q.shape[0] != m:
+    Q = np.asarray(Q)
+    if Q.shape[0] != H.shape[0]:
         raise ValueError("invalid shape")
-    if Q.shape[1] < r:
-        raise ValueError("invalid shape")
-    for j in range(r-1, -1, -1):
-        beta = H[j,j]
-        if np.equal(beta, 0):
-            continue
-        v = np.empty_like(H[j:,0])
-        v[0] = 1
-        v[1:] = H[j+1:,j]
-        Qpart = Q[j:,j:]
-        w = -beta * (Qpart.T @ v)
-        rank1update(Qpart, v, w, out=Qpart)
-    return Q
+    if trans:
+        return _dd_linalg.householder_apply_t(H, Q)
+    return _dd_linalg.householder_apply(H, Q)
+
+
+def householder_q(H, n=None):
+    """Forms the first `n` columns of the product of a set of reflectors.
+
+    Same as `householder_apply(H, np.eye(m, n))`, but faster, since the
+    columns known to remain columns of the identity are skipped.
+    """
+    H = np.asarray(H)
+    m = H.shape[0]
+    Q = np.empty((m, m if n is None else n), ddouble)
+    return _dd_linalg.householder_q(H, Q, out=Q)
 
 
 def svd_normalize(U, d, VH):
@@ -61,16 +61,30 @@ def update_flags(exec, update):
     return [cc_so] + cflags_so
 
 
+# Sources with hot kernels, which are compiled once for the baseline
+# architecture and once for every instruction set variant below.  The best
+# variant is then selected at import time (see csrc/dd_dispatch.h).
+DISPATCH_SOURCES = ["csrc/dd_arith.c", "csrc/dd_simd.c"]
+
+DISPATCH_VARIANTS = {
+    "avx2": ["-mavx2", "-mfma"],
+    "avx512": ["-mavx512f", "-mavx2", "-mfma"],
+    }
+
+
 class BuildExtWithNumpy(build_ext):
     """Wrapper class for building numpy extensions"""
     user_options = build_ext.user_options + [
         ("with-openmp=", None, "use openmp to build (default: true)"),
+        ("with-dispatch=", None,
+         "build kernels for several instruction sets (default: true)"),
         ("numpy-include-dir=", None, "numpy include directory"),
         ]
 
     def initialize_options(self):
         super().initialize_options()
         self.with_openmp = None
+        self.with_dispatch = None
         self.numpy_include_dir = None
 
     def finalize_options(self):
@@ -80,6 +94,8 @@ class BuildExtWithNumpy(build_ext):
         _convert_to_bool = {None: None, "true": True, "false": False}
         if self.with_openmp is not None:
             self.with_openmp = _convert_to_bool[self.with_openmp.lower()]
+        if self.with_dispatch is not None:
+            self.with_dispatch = _convert_to_bool[self.with_dispatch.lower()]
         if self.numpy_include_dir is not None:
             if not os.path.isdir(self.numpy_include_dir):
                 raise ValueError("include directory must exist")
@@ -105,12 +121,19 @@ class BuildExtWithNumpy(build_ext):
             # break with its own derived classes.  *slow-clap*
             compiler_make = 'msvc'
 
+        # Do not use -march=native here: the extension must be portable
+        # between machines, so we dispatch on the instruction set at runtime.
         if platform.system() == 'unix':
-            new_flags = {"-march": "native", "-mtune": "native",
-                         "-Wextra": None, "-std": "c11"}
+            new_flags = {"-Wextra": None, "-std": "c11"}
             self.compiler.compiler_so = update_flags(
                                     self.compiler.compiler_so, new_flags)
 
+        # Instruction set variants are built for x86 with GCC-like compilers
+        if self.with_dispatch is None:
+            self.with_dispatch = (
+                compiler_type == 'unix' and
+                platform.machine().lower() in ('x86_64', 'amd64'))
+
         # This has to be set to false because MacOS does not ship openmp
         # by default.
         if self.with_openmp is None:
@@ -133,6 +156,29 @@ class BuildExtWithNumpy(build_ext):
 
         super().build_extensions()
 
+    def build_extension(self, ext):
+        """Compile instruction set variants of kernels before linking"""
+        sources = [src for src in ext.sources if src in DISPATCH_SOURCES]
+        if self.with_dispatch and sources:
+            for variant, flags in DISPATCH_VARIANTS.items():
+                # Avoid contraction into FMA, which would make the result
+                # depend on the variant.
+                objects = self.compiler.compile(
+                    sources,
+                    output_dir=os.path.join(self.build_temp, variant),
+                    macros=ext.define_macros + [("DD_ISA", variant)],
+                    include_dirs=ext.include_dirs,
+                    debug=self.debug,
+                    extra_postargs=(ext.extra_compile_args + flags
+                                    + ["-ffp-contract=off"]),
+                    depends=ext.depends)
+                append_if_absent(ext.define_macros,
+                                 ("DD_DISPATCH_" + variant.upper(), None))
+                for obj in objects:
+                    append_if_absent(ext.extra_objects, obj)
+
+        super().build_extension(ext)
+
 
 VERSION = extract_version('pysrc', 'xprec', '__init__.py')
 REPO_URL = "https://github.com/tuwien-cms/xprec"
@@ -173,10 +219,12 @@ setup(
 
     ext_modules=[
         Extension("xprec._dd_ufunc",
-                  ["csrc/_dd_ufunc.c", "csrc/dd_arith.c"],
+                  ["csrc/_dd_ufunc.c", "csrc/dd_arith.c", "csrc/dd_parallel.c",
+                   "csrc/dd_simd.c"],
                   include_dirs=["csrc"]),
         Extension("xprec._dd_linalg",
-                  ["csrc/_dd_linalg.c", "csrc/dd_arith.c", "csrc/dd_linalg.c"],
+                  ["csrc/_dd_linalg.c", "csrc/dd_arith.c", "csrc/dd_linalg.c",
+                   "csrc/dd_parallel.c", "csrc/dd_simd.c"],
                   include_dirs=["csrc"]),
         ],
     setup_requires=[
@@ -1,6 +1,9 @@
 # Copyright (C) 2021 Markus Wallerberger and others
 # SPDX-License-Identifier: MIT
+import warnings
+
 import numpy as np
+import pytest
 
 import xprec
 import xprec.linalg
@@ -17,6 +20,112 @@ def test_householder_vec():
     np.testing.assert_allclose(eq[1:].astype(float), 0, atol=1e-31)
 
 
+@pytest.mark.parametrize('shape', [(1, 1, 1), (5, 3, 7), (67, 300, 1030)])
+def test_matmul(shape):
+    # The blocked product accumulates each element in order, so it must
+    # agree exactly with an outer-product loop.
+    ii, jj, kk = shape
+    rng = np.random.RandomState(4711)
+    A = rng.normal(size=(ii, jj)).astype(ddouble)
+    B = rng.normal(size=(jj, kk)).astype(ddouble)
+    C = np.zeros((ii, kk), ddouble)
+    for j in range(jj):
+        C = C + A[:, j:j+1] * B[j:j+1, :]
+
+    np.testing.assert_array_equal(A @ B, C)
+    np.testing.assert_array_equal(np.asfortranarray(A) @ B[:, ::-1],
+                                  C[:, ::-1])
+
+
+@pytest.mark.parametrize('shape', [(7, 3), (67, 1030), (130, 2500)])
+def test_matvec(shape):
+    # Matrix-vector products are computed like dot, whatever the layout
+    ii, jj = shape
+    rng = np.random.RandomState(4711)
+    A = rng.normal(size=(ii, jj)).astype(ddouble)
+    x = rng.normal(size=jj).astype(ddouble)
+    y = rng.normal(size=ii).astype(ddouble)
+    Ax = np.array([np.dot(A[i], x) for i in range(ii)])
+    yA = np.array([np.dot(y, A[:, j]) for j in range(jj)])
+
+    for A_ in (A, np.asfortranarray(A)):
+        np.testing.assert_array_equal(A_ @ x, Ax)
+        np.testing.assert_array_equal(y @ A_, yA)
+        np.testing.assert_array_equal(A_ @ x[:, None], Ax[:, None])
+
+
+@pytest.mark.parametrize('shape', [(2, 3, 4), (67, 30, 70)])
+def test_matmul_mixed(shape):
+    # Products with a double operand must not go through mulqq
+    ii, jj, kk = shape
+    rng = np.random.RandomState(4711)
+    A = rng.normal(size=(ii, jj))
+    B = rng.normal(size=(jj, kk)).astype(ddouble) / 3
+    C_dq = np.zeros((ii, kk), ddouble)
+    C_qd = np.zeros((kk, ii), ddouble)
+    for j in range(jj):
+        C_dq = C_dq + A[:, j:j+1] * B[j:j+1, :]
+        C_qd = C_qd + B.T[:, j:j+1] * A.T[j:j+1, :]
+
+    np.testing.assert_array_equal(A @ B, C_dq)
+    np.testing.assert_array_equal(B.T @ A.T, C_qd)
+
+
+@pytest.mark.parametrize('shape', [(1000, 3, 4, 5), (9, 40, 70, 30)])
+def test_matmul_stack(shape):
+    nn, ii, jj, kk = shape
+    rng = np.random.RandomState(4711)
+    A = rng.normal(size=(nn, ii, jj)).astype(ddouble)
+    B = rng.normal(size=(nn, jj, kk)).astype(ddouble)
+    grain_size = xprec.get_grain_size()
+    try:
+        xprec.set_grain_size(1)
+        C = A @ B
+    finally:
+        xprec.set_grain_size(grain_size)
+
+    for n in range(nn):
+        np.testing.assert_array_equal(C[n], A[n] @ B[n])
+
+
+@pytest.mark.parametrize('shape', [(3, 0, 4), (0, 3, 4), (3, 4, 0),
+                                   (5, 0, 0, 0)])
+@pytest.mark.parametrize('types', [(ddouble, ddouble), (float, ddouble),
+                                   (ddouble, float)])
+def test_matmul_empty(shape, types):
+    # Empty dimensions mean no work, which must not be split across threads
+    *nn, ii, jj, kk = shape
+    A = np.ones((*nn, ii, jj), types[0])
+    B = np.ones((*nn, jj, kk), types[1])
+    grain_size = xprec.get_grain_size()
+    try:
+        xprec.set_grain_size(1)
+        C = A @ B
+    finally:
+        xprec.set_grain_size(grain_size)
+
+    assert C.dtype == ddouble and C.shape == (*nn, ii, kk)
+    np.testing.assert_array_equal(C.astype(float), 0)
+    assert np.ones(0, types[0]) @ np.ones(0, types[1]) == 0
+
+
+def test_matmul_ozaki():
+    rng = np.random.RandomState(4711)
+    A = rng.normal(size=(4, 30, 70)) * 2.0**rng.randint(-40, 40, (4, 30, 1))
+    A = A.astype(ddouble) * (1 + 1e-17 * rng.normal(size=A.shape))
+    B = np.exp(5 * rng.normal(size=(70, 20))).astype(ddouble) / 3
+
+    C = xprec.linalg.matmul(A, B, method="ozaki")
+    C_ref = A @ B
+    C_abs = np.abs(A) @ np.abs(B)
+    np.testing.assert_array_less(np.abs(C - C_ref).astype(float),
+                                 1e-30 * C_abs.astype(float))
+
+    c = xprec.linalg.matmul(A[0, 0], B, method="ozaki")
+    np.testing.assert_array_less(np.abs(c - C_ref[0, 0]).astype(float),
+                                 1e-30 * C_abs[0, 0].astype(float))
+
+
 def test_bidiag():
     rng = np.random.RandomState(4711)
     m, n = 7, 5
@@ -40,6 +149,83 @@ def test_svd():
     np.testing.assert_allclose(s, sx, atol=1e-14 * sx[0], rtol=0)
 
 
+@pytest.mark.parametrize('shape', [(40, 70), (90, 1), (80, 60)])
+def test_svd_shapes(shape):
+    A = np.vander(np.linspace(-1, 1, shape[0]), shape[1]).astype(ddouble)
+    U, s, VT = xprec.linalg.svd(A, full_matrices=False)
+    k = min(shape)
+    np.testing.assert_allclose((U * s @ VT - A).astype(float), 0, atol=1e-29)
+    np.testing.assert_allclose((U.T @ U - np.eye(k)).astype(float), 0,
+                               atol=1e-29)
+    np.testing.assert_allclose((VT @ VT.T - np.eye(k)).astype(float), 0,
+                               atol=1e-29)
+    assert (s[1:] <= s[:-1]).all() and (s >= 0).all()
+
+
+@pytest.mark.parametrize('kind', ['random', 'wide', 'rank', 'graded', 'zero',
+                                  'zero-wide', 'zero-block'])
+def test_svd_dc(kind):
+    # Large enough for several levels of subproblems, with deflation
+    rng = np.random.RandomState(4711)
+    atol = 1e-29
+    if kind == 'random':
+        A = rng.normal(size=(130, 110))
+    elif kind == 'wide':
+        A = rng.normal(size=(70, 90))
+    elif kind == 'rank':
+        A = rng.normal(size=(100, 7)) @ rng.normal(size=(7, 100))
+    elif kind == 'zero':
+        A = np.zeros((60, 60))
+    elif kind == 'zero-wide':
+        A = np.zeros((26, 30))
+    elif kind == 'zero-block':
+        # The trailing block of the bidiagonal matrix is exactly zero.  Its
+        # poles are moved away from zero by 32 eps s[0] when merging (like
+        # dlasd2 does), which limits the residual.
+        A = np.zeros((80, 80))
+        A[:20, :20] = rng.normal(size=(20, 20))
+        atol = 5e-29
+    else:
+        A = np.diag(2.0**-np.arange(90)) @ rng.normal(size=(90, 90))
+    A = A.astype(ddouble)
+    U, s, VT = xprec.linalg.svd(A, full_matrices=False, method="dc")
+    k = min(A.shape)
+    np.testing.assert_allclose((U * s @ VT - A).astype(float), 0, atol=atol)
+    np.testing.assert_allclose((U.T @ U - np.eye(k)).astype(float), 0,
+                               atol=1e-29)
+    np.testing.assert_allclose((VT @ VT.T - np.eye(k)).astype(float), 0,
+                               atol=1e-29)
+
+    _, s_qr, _ = xprec.linalg.svd(A, full_matrices=False)
+    np.testing.assert_allclose((s - s_qr).astype(float), 0,
+                               atol=1e-29 * float(s[0]))
+
+
+@pytest.mark.parametrize('kind', ['tall', 'wide', 'cluster'])
+def test_svd_refine(kind):
+    rng = np.random.RandomState(4711)
+    if kind == 'tall':
+        A = rng.normal(size=(90, 60))
+    elif kind == 'wide':
+        A = rng.normal(size=(40, 70))
+    else:
+        # Three equal and two very close singular values
+        Q, _ = np.linalg.qr(rng.normal(size=(50, 50)))
+        A = Q * np.hstack([1, 1, 1, 2, 2 + 1e-12, np.linspace(3, 4, 45)])
+    A = A.astype(ddouble)
+    U, s, VT = xprec.linalg.svd_refine(A)
+    k = min(A.shape)
+    np.testing.assert_allclose((U * s @ VT - A).astype(float), 0, atol=1e-29)
+    np.testing.assert_allclose((U.T @ U - np.eye(k)).astype(float), 0,
+                               atol=1e-29)
+    np.testing.assert_allclose((VT @ VT.T - np.eye(k)).astype(float), 0,
+                               atol=1e-29)
+
+    _, s_ref, _ = xprec.linalg.svd(A, full_matrices=False)
+    np.testing.assert_allclose((np.sort(s) - np.sort(s_ref)).astype(float),
+                               0, atol=1e-29 * float(s_ref[0]))
+
+
 def test_givens():
     f, g = np.array([3.0, -2.0], dtype=ddouble)
     c, s, r = xprec.linalg.givens_rotation(f, g)
@@ -68,6 +254,44 @@ def test_qr():
     np.testing.assert_allclose(D.astype(float), 0, atol=4e-30)
 
 
+@pytest.mark.parametrize('shape', [(150, 130), (130, 150), (70, 3)])
+def test_qr_blocked(shape):
+    # Larger than one block of reflectors, tall and wide
+    m, n = shape
+    A = np.random.RandomState(4711).normal(size=shape).astype(ddouble)
+    H, R = xprec.linalg.qr(A, reflectors=True)
+    assert H.shape == (m, min(m, n))
+    np.testing.assert_array_equal(R, np.triu(R))
+
+    Q = xprec.linalg.householder_apply(H, np.eye(m, dtype=ddouble))
+    D = Q @ Q.T - np.eye(m)
+    np.testing.assert_allclose(D.astype(float), 0, atol=1e-30)
+    D = Q @ R - A
+    np.testing.assert_allclose(D.astype(float), 0, atol=1e-29)
+
+
+@pytest.mark.parametrize('shape', [(150, 130), (5, 5)])
+def test_householder_apply(shape):
+    m, n = shape
+    rng = np.random.RandomState(4711)
+    A = rng.normal(size=shape).astype(ddouble)
+    B = rng.normal(size=(m, 7)).astype(ddouble)
+    H, _ = xprec.linalg.qr(A, reflectors=True)
+
+    # Reference: apply reflectors one by one
+    Q = np.eye(m, dtype=ddouble)
+    for j in range(H.shape[1]):
+        v = np.hstack([np.zeros(j), 1, H[j+1:,j]]).astype(ddouble)
+        Q = Q - H[j,j] * np.outer(Q @ v, v)
+
+    QB = xprec.linalg.householder_apply(H, B)
+    np.testing.assert_allclose((QB - Q @ B).astype(float), 0, atol=1e-30)
+    QTB = xprec.linalg.householder_apply(H, B, trans=True)
+    np.testing.assert_allclose((QTB - Q.T @ B).astype(float), 0, atol=1e-30)
+    Q_n = xprec.linalg.householder_q(H, 3)
+    np.testing.assert_allclose((Q_n - Q[:,:3]).astype(float), 0, atol=1e-30)
+
+
 def test_qr_pivot():
     A = np.vander(np.linspace(-1, 1, 60), 80).astype(ddouble)
     Q, R, piv = xprec.linalg.rrqr(A)
@@ -82,7 +306,81 @@ def test_qr_pivot():
     assert (Rdiag[1:] <= Rdiag[:-1]).all()
 
 
+def test_qr_pivot_truncated():
+    # Tall matrix of rank 20, where the factorization stops early
+    rng = np.random.RandomState(4711)
+    A = (rng.normal(size=(120, 20)).astype(ddouble)
+         @ rng.normal(size=(20, 90)).astype(ddouble))
+    Q, R, piv = xprec.linalg.rrqr(A, tol=1e-28)
+    assert Q.shape == (120, 21) and R.shape == (21, 90)
+    np.testing.assert_array_equal(np.sort(piv), np.arange(90))
+
+    D = Q.T @ Q - np.eye(21)
+    np.testing.assert_allclose(D.astype(float), 0, atol=1e-30)
+    D = Q @ R - A[:,piv]
+    np.testing.assert_allclose(D.astype(float), 0, atol=1e-27)
+
+
+@pytest.mark.parametrize("kind", ["random", "vector", "hilbert"])
+def test_solve(kind):
+    rng = np.random.RandomState(4711)
+    if kind == "hilbert":
+        # Far too ill-conditioned for double, so the refinement stalls
+        i = np.arange(14).astype(ddouble)
+        A = 1 / (i[:, None] + i[None, :] + 1)
+        b = rng.normal(size=(14, 3)).astype(ddouble)
+    else:
+        A = rng.normal(size=(150, 150)).astype(ddouble)
+        b = rng.normal(size=(150, 5) if kind == "random" else 150)
+        b = b.astype(ddouble)
+    x = xprec.linalg.solve(A, b)
+    assert x.shape == b.shape
+
+    # Backward error must be of the order of the rounding error
+    D = (b - A @ x) / (np.abs(A).sum(1).max() * np.abs(x).max(0))
+    np.testing.assert_allclose(D.astype(float), 0, atol=1e-30)
+
+
+def test_lu_solve():
+    rng = np.random.RandomState(4711)
+    A = rng.normal(size=(150, 150)).astype(ddouble)
+    b = rng.normal(size=(150, 5)).astype(ddouble)
+    x, info = xprec._dd_linalg.lu_solve(A.T, b)
+    assert info == 0
+    D = b - A.T @ x
+    np.testing.assert_allclose(D.astype(float), 0, atol=1e-28)
+
+    A[:, 100] = 0
+    with pytest.raises(np.linalg.LinAlgError):
+        xprec.linalg.solve(A, b)
+
+
+def test_qr_pivot_zero():
+    # The stopping criterion is relative to R[0, 0], so it is not applied
+    with warnings.catch_warnings():
+        warnings.simplefilter("error")
+        Q, R, piv = xprec.linalg.rrqr(np.zeros((4, 3), ddouble))
+    assert Q.shape == (4, 3) and R.shape == (3, 3)
+    np.testing.assert_array_equal(R.astype(float), 0)
+    np.testing.assert_array_equal((Q.T @ Q).astype(float), np.eye(3))
+
+
 def test_jacobi():
     A = np.vander(np.linspace(-1, 1, 60), 80).astype(ddouble)
     U, s, VT = xprec.linalg.svd_trunc(A)
     np.testing.assert_allclose((U * s) @ VT - A, 0.0, atol=5e-30)
+
+
+@pytest.mark.parametrize('block', [1, 16, 256])
+def test_jacobi_sweep(block):
+    # Large enough for the pairs to be rotated in parallel.  A parallel sweep
+    # must do the same as a cyclic one, which leaves the columns sorted.
+    rng = np.random.RandomState(4711)
+    A = rng.normal(size=(300, 200)).astype(ddouble)
+    U, s, VT = xprec.linalg.svd_jacobi(A, tol=1e-30, block=block)
+    assert (s[1:] <= s[:-1]).all()
+    # Each block update sums over the columns of two blocks
+    atol = 1e-28 if block == 1 else 3e-28
+    np.testing.assert_allclose((U * s @ VT - A).astype(float), 0, atol=atol)
+    np.testing.assert_allclose((U.T @ U - np.eye(200)).astype(float), 0,
+                               atol=1e-29)
@@ -1,6 +1,13 @@
 # Copyright (C) 2021 Markus Wallerberger and others
 # SPDX-License-Identifier: MIT
+from fractions import Fraction
+import os
+import subprocess
+import sys
+
 import numpy as np
+import pytest
+
 import xprec
 
 
@@ -15,6 +22,39 @@ def _compare_ufunc(ufunc, *args, ulps=1):
 def test_log():
     x = np.geomspace(1e-300, 1e300, 1953)
     _compare_ufunc(np.log, x)
+    _compare_ufunc(np.log2, x)
+    _compare_ufunc(np.log10, x)
+
+
+def test_log1p():
+    x = np.geomspace(1e-300, 1e300, 1953)
+    x = np.hstack([-np.geomspace(1e-300, 0.99, 1953), 0, x])
+    _compare_ufunc(np.log1p, x)
+
+
+def test_log2():
+    # log2 is exact for powers of two
+    x = np.ldexp(1.0, np.arange(-1000, 1000)).astype(xprec.ddouble)
+    np.testing.assert_array_equal(np.log2(x).astype(float),
+                                  np.arange(-1000, 1000))
+
+
+def test_log_special():
+    x = np.array([0.0, -1.0, np.inf, np.nan])
+    with np.errstate(divide='ignore', invalid='ignore'):
+        for ufunc in [np.log, np.log2, np.log10]:
+            np.testing.assert_array_equal(
+                ufunc(x.astype(xprec.ddouble)).astype(float), ufunc(x))
+        np.testing.assert_array_equal(
+            np.log1p((x - 1).astype(xprec.ddouble)).astype(float),
+            np.log1p(x - 1))
+
+
+def test_exp_special():
+    x = np.array([np.nan, np.inf, -np.inf, 0.0])
+    for ufunc in [np.exp, np.expm1, np.sinh, np.cosh, np.tanh]:
+        np.testing.assert_array_equal(
+            ufunc(x.astype(xprec.ddouble)).astype(float), ufunc(x))
 
 
 def test_sqrt():
@@ -43,7 +83,188 @@ def test_cosh():
     assert np.isinf(np.cosh(-thousand))
 
 
+def test_sincos():
+    x = np.geomspace(1e-300, 1e300, 1953)
+    x = np.hstack([-x[::-1], 0, x])
+    _compare_ufunc(np.sin, x)
+    _compare_ufunc(np.cos, x)
+
+    xq = x.astype(xprec.ddouble)
+    s, c = xprec.sincos(xq)
+    np.testing.assert_array_equal(s.view(float), np.sin(xq).view(float))
+    np.testing.assert_array_equal(c.view(float), np.cos(xq).view(float))
+
+
 def test_hypot():
     x = np.geomspace(1e-300, 1e260, 47)
     x = np.hstack([-x[::-1], 0, x])
     _compare_ufunc(np.hypot, x[:,None], x[None,:])
+
+
+@pytest.mark.parametrize('ufunc', [np.add, np.subtract, np.multiply, np.divide])
+def test_arith_contiguous(ufunc):
+    # Contiguous operands use vectorized kernels, which must agree bitwise
+    # with the strided loop, including the scalar remainder.
+    rng = np.random.RandomState(4711)
+    x = rng.normal(size=(2, 37)).astype(xprec.ddouble) / 3
+    y = rng.normal(size=(2, 37))
+    for a, b in [(x[0], x[1]), (x[0], y[1]), (y[0], x[1])]:
+        res_strided = ufunc(a[None,:], b[:,None])[np.arange(37), np.arange(37)]
+        res_contig = ufunc(a, b)
+        np.testing.assert_array_equal(res_contig.view(float),
+                                      res_strided.view(float))
+
+
+@pytest.mark.parametrize('ufunc', [np.add, np.divide, np.exp, np.sin,
+                                   xprec.sincos, np.hypot])
+def test_parallel(ufunc):
+    # Splitting loops across threads must not change the result
+    rng = np.random.RandomState(4711)
+    x = rng.normal(size=(ufunc.nin, 10001)).astype(xprec.ddouble)
+    grain_size = xprec.get_grain_size()
+    try:
+        xprec.set_grain_size(1)
+        res_parallel = np.reshape(ufunc(*x), (ufunc.nout, -1))
+        xprec.set_grain_size(sys.maxsize)
+        res_serial = np.reshape(ufunc(*x), (ufunc.nout, -1))
+    finally:
+        xprec.set_grain_size(grain_size)
+
+    for rp, rs in zip(res_parallel, res_serial):
+        np.testing.assert_array_equal(rp.view(float), rs.view(float))
+
+    with pytest.raises(ValueError):
+        xprec.set_grain_size(0)
+
+
+@pytest.mark.parametrize('n', [1, 7, 8, 1000, 5001])
+def test_reduce(n):
+    rng = np.random.RandomState(4711)
+    x = rng.normal(size=n) * 2.0**rng.randint(-30, 30, size=n)
+    exact = sum(map(Fraction, x))
+
+    xq = x.astype(xprec.ddouble)
+    sum_q = np.add.reduce(xq, keepdims=True).view(float)
+    assert abs(Fraction(sum_q[0]) + Fraction(sum_q[1]) - exact) \
+            <= 1e-30 * np.abs(x).sum()
+
+    # Strided input takes a different code path, but must agree
+    sum_s = np.add.reduce(np.repeat(xq, 2)[::2], keepdims=True).view(float)
+    np.testing.assert_array_equal(sum_q, sum_s)
+
+    y = 1 + rng.normal(size=n) / 1e3
+    prod_q = np.multiply.reduce(y.astype(xprec.ddouble))
+    np.testing.assert_allclose(float(prod_q), np.prod(y), rtol=1e-12)
+
+
+@pytest.mark.parametrize('n', [1, 7, 8, 1000, 5001])
+def test_dot(n):
+    rng = np.random.RandomState(4712)
+    x = rng.normal(size=n) * 2.0**rng.randint(-30, 30, size=n)
+    y = rng.normal(size=n)
+    exact = sum(Fraction(xi) * Fraction(yi) for xi, yi in zip(x, y))
+
+    xq = x.astype(xprec.ddouble)
+    yq = y.astype(xprec.ddouble)
+    dot_q = np.reshape(np.dot(xq, yq), 1).view(float)
+    assert abs(Fraction(dot_q[0]) + Fraction(dot_q[1]) - exact) \
+            <= 1e-30 * np.abs(x * y).sum()
+
+    # Strided input takes a different code path, but must agree
+    xs = np.repeat(xq, 3)[::3]
+    for args in (xs, yq), (xq, np.repeat(yq, 2)[::2]):
+        dot_s = np.reshape(np.dot(*args), 1).view(float)
+        np.testing.assert_array_equal(dot_q, dot_s)
+
+
+@pytest.mark.parametrize('n', [0, 1, 7, 1000, 5001])
+def test_dot2_sum2(n):
+    rng = np.random.RandomState(4713)
+    x = rng.normal(size=n) * 2.0**rng.randint(-30, 30, size=n)
+    y = rng.normal(size=n)
+    exact_dot = sum(Fraction(xi) * Fraction(yi) for xi, yi in zip(x, y))
+    exact_sum = sum(Fraction(xi) for xi in x)
+
+    dot = np.reshape(xprec.dot2(x, y), 1).view(float)
+    assert abs(Fraction(dot[0]) + Fraction(dot[1]) - exact_dot) \
+            <= 1e-30 * np.abs(x * y).sum()
+    sum_ = np.reshape(xprec.sum2(x), 1).view(float)
+    assert abs(Fraction(sum_[0]) + Fraction(sum_[1]) - exact_sum) \
+            <= 1e-30 * np.abs(x).sum()
+
+    # Strided and stacked input
+    xy = np.stack([y, x], axis=1)
+    np.testing.assert_array_equal(xprec.dot2(xy.T, x), [xprec.dot2(y, x),
+                                                        xprec.dot2(x, x)])
+    np.testing.assert_array_equal(xprec.sum2(xy[:, 1]), xprec.sum2(x))
+
+
+@pytest.mark.parametrize('n', [1, 9, 5001])
+def test_sum_double(n):
+    # Reducing doubles into ddouble uses a separate kernel without a cast
+    rng = np.random.RandomState(4714)
+    x = rng.normal(size=n) * 2.0**rng.randint(-30, 30, size=n)
+    exact = sum(Fraction(xi) for xi in x)
+
+    sum_ = np.reshape(np.sum(x, dtype=xprec.ddouble), 1).view(float)
+    assert abs(Fraction(sum_[0]) + Fraction(sum_[1]) - exact) \
+            <= 1e-30 * np.abs(x).sum()
+
+    x2 = np.reshape(x[:n // 3 * 3], (-1, 3))
+    np.testing.assert_array_equal(np.sum(x2, axis=0, dtype=xprec.ddouble),
+                                  np.sum(x2.astype(xprec.ddouble), axis=0))
+
+
+DETERMINISTIC_SCRIPT = """
+import numpy as np, xprec, xprec.linalg
+xprec.set_deterministic(True)
+xprec.set_grain_size(1)
+x = np.random.RandomState(4711).normal(size=100001).astype(xprec.ddouble)
+res = [np.add.reduce(x), np.dot(x, x[::-1]), xprec.linalg.norm(x)]
+print(np.array(res).view(float).tobytes().hex())
+"""
+
+
+def test_deterministic():
+    # The result must not depend on the number of threads, so we need to
+    # start a new process for each.
+    results = set()
+    for nthreads in 1, 2, 3:
+        env = dict(os.environ, OMP_NUM_THREADS=str(nthreads))
+        out = subprocess.run([sys.executable, "-c", DETERMINISTIC_SCRIPT],
+                             env=env, check=True, capture_output=True)
+        results.add(out.stdout)
+    assert len(results) == 1
+
+    deterministic = xprec.get_deterministic()
+    try:
+        xprec.set_deterministic(True)
+        assert xprec.get_deterministic()
+    finally:
+        xprec.set_deterministic(deterministic)
+
+
+@pytest.mark.parametrize('ufunc', [np.add, np.multiply, np.hypot])
+def test_accumulate(ufunc):
+    # Accumulation aliases input and output, so the iterations depend on
+    # each other and must not be vectorized or split across threads.
+    x = np.linspace(0.5, 1.5, 10001)
+    grain_size = xprec.get_grain_size()
+    try:
+        xprec.set_grain_size(1)
+        res_q = ufunc.accumulate(x.astype(xprec.ddouble))
+    finally:
+        xprec.set_grain_size(grain_size)
+
+    res_d = ufunc.accumulate(x)
+    np.testing.assert_allclose(res_q.astype(float), res_d, rtol=1e-12)
+
+
+def test_dispatch_variant():
+    assert xprec.dispatch_variant() in ('baseline', 'avx2', 'avx512')
+
+
+def test_exp_accuracy():
+    x = np.linspace(-700, 700, 2001).astype(xprec.ddouble) / 3
+    res = np.exp(x) * np.exp(-x) - 1
+    np.testing.assert_allclose(res.astype(float), 0, atol=1e-31)